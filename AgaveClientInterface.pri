@@ -4,7 +4,15 @@ SOURCES += \
     $$PWD/agaveInterfaces/agavehandler.cpp \
     $$PWD/agaveInterfaces/agavetaskguide.cpp \
     $$PWD/agaveInterfaces/agavetaskreply.cpp \
+    $$PWD/agaveInterfaces/agavedownloadtarget.cpp \
+    $$PWD/agaveInterfaces/agavesegmenteddownload.cpp \
+    $$PWD/agaveInterfaces/agavestreamupload.cpp \
+    $$PWD/agaveInterfaces/agaverequestscheduler.cpp \
+    $$PWD/agaveInterfaces/agaveresponsecache.cpp \
+    $$PWD/agaveInterfaces/agaveretrypolicy.cpp \
+    $$PWD/agaveInterfaces/agavereplyproxy.cpp \
     $$PWD/remotedatainterface.cpp \
+    $$PWD/remotedatafuture.cpp \
     $$PWD/filemetadata.cpp \
     $$PWD/remotejobdata.cpp \
     $$PWD/remoteFiles/filenoderef.cpp \
@@ -17,13 +25,22 @@ SOURCES += \
     $$PWD/remoteJobs/remotejoblister.cpp \
     $$PWD/remoteJobs/jobstandarditem.cpp \
     $$PWD/remoteFiles/filerecursiveoperator.cpp \
-    $$PWD/remoteFiles/filestandarditem.cpp
+    $$PWD/remoteFiles/filestandarditem.cpp \
+    $$PWD/remoteFiles/remotefiledevice.cpp
 
 HEADERS += \
     $$PWD/agaveInterfaces/agavehandler.h \
     $$PWD/agaveInterfaces/agavetaskguide.h \
     $$PWD/agaveInterfaces/agavetaskreply.h \
+    $$PWD/agaveInterfaces/agavedownloadtarget.h \
+    $$PWD/agaveInterfaces/agavesegmenteddownload.h \
+    $$PWD/agaveInterfaces/agavestreamupload.h \
+    $$PWD/agaveInterfaces/agaverequestscheduler.h \
+    $$PWD/agaveInterfaces/agaveresponsecache.h \
+    $$PWD/agaveInterfaces/agaveretrypolicy.h \
+    $$PWD/agaveInterfaces/agavereplyproxy.h \
     $$PWD/remotedatainterface.h \
+    $$PWD/remotedatafuture.h \
     $$PWD/filemetadata.h \
     $$PWD/remotejobdata.h \
     $$PWD/remoteFiles/filenoderef.h \
@@ -36,7 +53,8 @@ HEADERS += \
     $$PWD/remoteJobs/remotejoblister.h \
     $$PWD/remoteJobs/jobstandarditem.h \
     $$PWD/remoteFiles/filerecursiveoperator.h \
-    $$PWD/remoteFiles/filestandarditem.h
+    $$PWD/remoteFiles/filestandarditem.h \
+    $$PWD/remoteFiles/remotefiledevice.h
 
 DISTFILES += \
     $$PWD/doxygen.cfg
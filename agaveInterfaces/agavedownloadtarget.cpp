@@ -0,0 +1,310 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agavedownloadtarget.h"
+
+#include "remotedatainterface.h"
+
+#include <QSaveFile>
+#include <QJsonObject>
+
+AgaveDownloadTarget::AgaveDownloadTarget(QString destination)
+{
+    finalName = destination;
+    journalName = journalNameFor(finalName);
+    partFile.setFileName(QString("%1.part").arg(finalName));
+}
+
+AgaveDownloadTarget::~AgaveDownloadTarget()
+{
+    //Anything not explicitly committed or discarded is kept for a later resume
+    if (!committed && partFile.isOpen())
+    {
+        suspend();
+    }
+}
+
+bool AgaveDownloadTarget::open(qint64 startOffset)
+{
+    if (partFile.isOpen()) return true;
+
+    if (QFile::exists(finalName))
+    {
+        qCDebug(remoteInterface, "ERROR: Download destination already exists: %s", qPrintable(finalName));
+        return false;
+    }
+
+    if (startOffset <= 0)
+    {
+        if (!partFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qCDebug(remoteInterface, "ERROR: Unable to open partial download file: %s", qPrintable(partFile.fileName()));
+            return false;
+        }
+        bytesWritten = 0;
+        preallocatedSize = 0;
+        positionedWrites = false;
+    }
+    else
+    {
+        if (!partFile.open(QIODevice::ReadWrite))
+        {
+            qCDebug(remoteInterface, "ERROR: Unable to reopen partial download file: %s", qPrintable(partFile.fileName()));
+            return false;
+        }
+        if ((partFile.size() < startOffset) || !partFile.seek(startOffset))
+        {
+            qCDebug(remoteInterface, "ERROR: Partial download file shorter than its journal: %s", qPrintable(partFile.fileName()));
+            partFile.close();
+            return false;
+        }
+        bytesWritten = startOffset;
+        //Space past the offset may have been reserved by the earlier attempt
+        preallocatedSize = partFile.size();
+    }
+
+    journaledBytes = bytesWritten;
+    return true;
+}
+
+void AgaveDownloadTarget::setRemoteInfo(QString remoteName, qint64 remoteSize, QByteArray lastModified)
+{
+    remoteFileName = remoteName;
+    remoteTotalSize = remoteSize;
+    remoteLastModified = lastModified;
+
+    if (partFile.isOpen())
+    {
+        saveJournal();
+    }
+}
+
+void AgaveDownloadTarget::preallocate(qint64 totalSize)
+{
+    if (!partFile.isOpen()) return;
+    if (totalSize <= bytesWritten) return;
+    if (totalSize <= preallocatedSize) return;
+
+    //Reserving the space up front keeps the file contiguous and fails early if the disk is full.
+    //If the filesystem refuses, we just carry on writing sequentially.
+    if (partFile.resize(totalSize))
+    {
+        preallocatedSize = totalSize;
+        partFile.seek(bytesWritten);
+    }
+}
+
+bool AgaveDownloadTarget::append(const QByteArray &chunk)
+{
+    if (!partFile.isOpen()) return false;
+    if (chunk.isEmpty()) return true;
+
+    qint64 written = partFile.write(chunk);
+    if (written != chunk.size())
+    {
+        qCDebug(remoteInterface, "ERROR: Short write to partial download file: %s", qPrintable(partFile.errorString()));
+        return false;
+    }
+    bytesWritten += written;
+
+    if (bytesWritten - journaledBytes >= journalInterval)
+    {
+        if (partFile.flush())
+        {
+            saveJournal();
+        }
+    }
+    return true;
+}
+
+bool AgaveDownloadTarget::writeAt(qint64 offset, const QByteArray &chunk)
+{
+    if (!partFile.isOpen()) return false;
+    if (chunk.isEmpty()) return true;
+
+    positionedWrites = true;
+
+    if (!partFile.seek(offset)) return false;
+    qint64 written = partFile.write(chunk);
+    if (written != chunk.size())
+    {
+        qCDebug(remoteInterface, "ERROR: Short write to partial download file: %s", qPrintable(partFile.errorString()));
+        return false;
+    }
+
+    if (offset + written > bytesWritten)
+    {
+        bytesWritten = offset + written;
+    }
+    return true;
+}
+
+bool AgaveDownloadTarget::commit()
+{
+    if (!partFile.isOpen()) return false;
+
+    if (!partFile.flush())
+    {
+        return false;
+    }
+
+    //The server may have sent less than it announced
+    if ((preallocatedSize > bytesWritten) && !partFile.resize(bytesWritten))
+    {
+        return false;
+    }
+    partFile.close();
+
+    if (!partFile.rename(finalName))
+    {
+        qCDebug(remoteInterface, "ERROR: Unable to move download into place: %s", qPrintable(finalName));
+        return false;
+    }
+    QFile::remove(journalName);
+    committed = true;
+    return true;
+}
+
+void AgaveDownloadTarget::suspend()
+{
+    if (!partFile.isOpen()) return;
+
+    if ((bytesWritten <= 0) || positionedWrites)
+    {
+        discard();
+        return;
+    }
+
+    partFile.flush();
+    saveJournal();
+    partFile.close();
+    qCDebug(remoteInterface, "Partial download kept for resume at byte %lld: %s", bytesWritten, qPrintable(partFile.fileName()));
+}
+
+void AgaveDownloadTarget::discard()
+{
+    if (partFile.isOpen())
+    {
+        partFile.close();
+    }
+    if (partFile.exists())
+    {
+        partFile.remove();
+    }
+    QFile::remove(journalName);
+    bytesWritten = 0;
+    journaledBytes = 0;
+    preallocatedSize = 0;
+    positionedWrites = false;
+}
+
+bool AgaveDownloadTarget::isOpen()
+{
+    return partFile.isOpen();
+}
+
+qint64 AgaveDownloadTarget::getBytesWritten()
+{
+    return bytesWritten;
+}
+
+QString AgaveDownloadTarget::getDestination()
+{
+    return finalName;
+}
+
+QString AgaveDownloadTarget::getPartFileName()
+{
+    return partFile.fileName();
+}
+
+qint64 AgaveDownloadTarget::findResumeOffset(QString destination, QString remoteName, QByteArray * lastModified, qint64 * remoteSize)
+{
+    if (QFile::exists(destination)) return 0;
+
+    QFile journalFile(journalNameFor(destination));
+    if (!journalFile.open(QIODevice::ReadOnly)) return 0;
+
+    QJsonDocument journalDoc = QJsonDocument::fromJson(journalFile.readAll());
+    journalFile.close();
+    if (!journalDoc.isObject()) return 0;
+
+    QJsonObject journalData = journalDoc.object();
+    if (journalData.value("remoteName").toString() != remoteName) return 0;
+
+    qint64 offset = static_cast<qint64>(journalData.value("offset").toDouble());
+    if (offset <= 0) return 0;
+
+    QFile partFile(QString("%1.part").arg(destination));
+    if (!partFile.exists() || (partFile.size() < offset)) return 0;
+
+    //Without a validator, a changed remote file could not be told apart from the one we started
+    QByteArray journalLastModified = journalData.value("lastModified").toString().toLatin1();
+    if (journalLastModified.isEmpty()) return 0;
+
+    if (lastModified != nullptr)
+    {
+        *lastModified = journalLastModified;
+    }
+    if (remoteSize != nullptr)
+    {
+        *remoteSize = static_cast<qint64>(journalData.value("remoteSize").toDouble(-1));
+    }
+    return offset;
+}
+
+bool AgaveDownloadTarget::saveJournal()
+{
+    if (positionedWrites) return false;
+
+    QJsonObject journalData;
+    journalData.insert("remoteName", remoteFileName);
+    journalData.insert("offset", static_cast<double>(bytesWritten));
+    journalData.insert("remoteSize", static_cast<double>(remoteTotalSize));
+    journalData.insert("lastModified", QString::fromLatin1(remoteLastModified));
+
+    QSaveFile journalFile(journalName);
+    if (!journalFile.open(QIODevice::WriteOnly)) return false;
+    journalFile.write(QJsonDocument(journalData).toJson(QJsonDocument::Compact));
+    if (!journalFile.commit()) return false;
+
+    journaledBytes = bytesWritten;
+    return true;
+}
+
+QString AgaveDownloadTarget::journalNameFor(QString destination)
+{
+    return QString("%1.part.journal").arg(destination);
+}
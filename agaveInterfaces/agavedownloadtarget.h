@@ -0,0 +1,98 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVEDOWNLOADTARGET_H
+#define AGAVEDOWNLOADTARGET_H
+
+#include <QString>
+#include <QFile>
+
+/*! \brief The AgaveDownloadTarget is the local side of a streamed file download.
+ *
+ *  Incoming data is written to a ".part" file next to the final destination as it arrives.
+ *  Only when the transfer completes is the ".part" file renamed to the destination name,
+ *  so a half-finished download never appears under the real file name.
+ *
+ *  Alongside the ".part" file, a small journal records how many bytes are safely on disk,
+ *  and the remote file's size and last-modified stamp. If a transfer is interrupted, the next
+ *  download of the same remote file to the same destination can ask for only the missing bytes.
+ *  Files filled by positioned writes (see AgaveSegmentedDownload) may have gaps, so they are not journaled.
+ */
+
+class AgaveDownloadTarget
+{
+public:
+    explicit AgaveDownloadTarget(QString destination);
+    ~AgaveDownloadTarget();
+
+    bool open(qint64 startOffset = 0);
+    void setRemoteInfo(QString remoteName, qint64 remoteSize, QByteArray lastModified);
+    void preallocate(qint64 totalSize);
+    bool append(const QByteArray &chunk);
+    bool writeAt(qint64 offset, const QByteArray &chunk);
+    bool commit();
+    void suspend();
+    void discard();
+
+    bool isOpen();
+    qint64 getBytesWritten();
+    QString getDestination();
+    QString getPartFileName();
+
+    //Gives 0 unless the journal has a last-modified stamp, so a resume can always be validated with If-Range
+    static qint64 findResumeOffset(QString destination, QString remoteName, QByteArray * lastModified, qint64 * remoteSize = nullptr);
+
+private:
+    bool saveJournal();
+    static QString journalNameFor(QString destination);
+
+    QString finalName;
+    QString journalName;
+    QFile partFile;
+
+    QString remoteFileName;
+    qint64 remoteTotalSize = -1;
+    QByteArray remoteLastModified;
+
+    qint64 bytesWritten = 0;
+    qint64 journaledBytes = 0;
+    qint64 preallocatedSize = 0;
+    bool committed = false;
+    bool positionedWrites = false;
+
+    const qint64 journalInterval = 8388608;
+};
+
+#endif // AGAVEDOWNLOADTARGET_H
@@ -37,16 +37,57 @@
 
 #include "agavetaskguide.h"
 #include "agavetaskreply.h"
+#include "agavedownloadtarget.h"
+#include "agavesegmenteddownload.h"
+#include "agavestreamupload.h"
+#include "agaverequestscheduler.h"
+#include "agaveresponsecache.h"
+#include "agavereplyproxy.h"
 
 #include "filemetadata.h"
 
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+
+#include <limits>
+
 //TODO: need to do more double checking of valid file paths
 
+//The HTTP/2 attributes were renamed in Qt 5.15
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+static const QNetworkRequest::Attribute http2AllowedAttribute = QNetworkRequest::Http2AllowedAttribute;
+static const QNetworkRequest::Attribute http2WasUsedAttribute = QNetworkRequest::Http2WasUsedAttribute;
+#else
+static const QNetworkRequest::Attribute http2AllowedAttribute = QNetworkRequest::HTTP2AllowedAttribute;
+static const QNetworkRequest::Attribute http2WasUsedAttribute = QNetworkRequest::HTTP2WasUsedAttribute;
+#endif
+
 AgaveHandler::AgaveHandler(QNetworkAccessManager *netAccessManager, QObject *parent) :
         RemoteDataInterface(parent), SSLoptions()
 {
     networkHandle = netAccessManager;
     SSLoptions.setProtocol(QSsl::SecureProtocols);
+    //Offering h2 lets requests share one multiplexed connection, when the server agrees
+    SSLoptions.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+    //Needed for sessionTicket() to be filled in, so it can be kept for the next process (see setSessionTicketFile)
+    SSLoptions.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    ticketWriteTimer = new QTimer(this);
+    ticketWriteTimer->setSingleShot(true);
+    ticketWriteTimer->setInterval(ticketWriteDelay);
+    QObject::connect(ticketWriteTimer, SIGNAL(timeout()), this, SLOT(writeSessionTicket()));
+    requestScheduler = new AgaveRequestScheduler(this);
+    tokenRefreshTimer = new QTimer(this);
+    tokenRefreshTimer->setSingleShot(true);
+    QObject::connect(tokenRefreshTimer, SIGNAL(timeout()), this, SLOT(refreshAccessToken()));
+    qRegisterMetaType<RequestPriority>("RequestPriority");
+    //Reply signals are held and given again by AgaveReplyProxy, and are queued to callers in other threads
+    qRegisterMetaType<RequestState>("RequestState");
+    qRegisterMetaType<FileMetaData>("FileMetaData");
+    qRegisterMetaType<QList<FileMetaData>>("QList<FileMetaData>");
+    qRegisterMetaType<RemoteJobData>("RemoteJobData");
+    qRegisterMetaType<QList<RemoteJobData>>("QList<RemoteJobData>");
     changeAuthState(RemoteDataInterfaceState::INIT);
 
     if (networkHandle == nullptr)
@@ -57,6 +98,31 @@ AgaveHandler::AgaveHandler(QNetworkAccessManager *netAccessManager, QObject *par
 
 void AgaveHandler::finishedOneTask()
 {
+    QNetworkReply * finishedReply = qobject_cast<QNetworkReply *>(sender());
+    if (finishedReply != nullptr)
+    {
+        //Some proxies and servers mishandle HTTP/2, so later requests go back to HTTP/1.1
+        if (http2Enabled && (finishedReply->error() == QNetworkReply::ProtocolFailure)
+                && finishedReply->attribute(http2WasUsedAttribute).toBool())
+        {
+            qCDebug(remoteInterface, "HTTP/2 protocol failure, falling back to HTTP/1.1");
+            http2Enabled = false;
+        }
+
+        QByteArray newTicket = finishedReply->sslConfiguration().sessionTicket();
+        if (!newTicket.isEmpty() && (newTicket != SSLoptions.sessionTicket()))
+        {
+            SSLoptions.setSessionTicket(newTicket);
+            storeSessionTicket(newTicket, finishedReply->sslConfiguration().sessionTicketLifeTimeHint());
+        }
+
+        QString coalesceKey = finishedReply->property("coalesceKey").toString();
+        if (!coalesceKey.isEmpty() && (inFlightGets.value(coalesceKey) == finishedReply))
+        {
+            inFlightGets.remove(coalesceKey);
+        }
+    }
+
     pendingRequestCount--;
     if (pendingRequestCount < 0)
     {
@@ -84,35 +150,31 @@ AgaveHandler::~AgaveHandler()
     {
         delete aTaskGuide;
     }
-}
-
-QString AgaveHandler::getUserName()
-{
-    if (QThread::currentThread() != this->thread())
+    if (ticketWriteTimer->isActive())
     {
-        QString retVal;
-        QMetaObject::invokeMethod(this, "getUserName", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(QString, retVal));
-        return retVal;
+        writeSessionTicket();
     }
-
-    if (currentState == RemoteDataInterfaceState::CONNECTED)
+    submissionLock.lock();
+    for (PendingSubmission &aSubmission : submissionQueue)
     {
-        return authUname;
+        delete aSubmission.proxyReply;
     }
-    return QString();
+    submissionQueue.clear();
+    submissionLock.unlock();
+    qDeleteAll(userNameSnapshots);
+}
+
+QString AgaveHandler::getUserName()
+{
+    //Read from the snapshot, so that other threads need not wait on this one
+    return *(userNameSnapshot.loadAcquire());
 }
 
 RemoteDataReply * AgaveHandler::performAuth(QString uname, QString passwd)
 {   
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "performAuth", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, uname),
-                                  Q_ARG(QString, passwd));
-        return retVal;
+        return submitRequest([=]() { return performAuth(uname, passwd); });
     }
 
     if (currentState != RemoteDataInterfaceState::READY_TO_AUTH)
@@ -126,16 +188,92 @@ RemoteDataReply * AgaveHandler::performAuth(QString uname, QString passwd)
     authPass = passwd;
 
     authEncoded = "Basic ";
-    QByteArray rawAuth(uname.toLatin1());
+    QByteArray rawAuth(uname.toUtf8());
     rawAuth.append(":");
     rawAuth.append(passwd);
     authEncoded.append(rawAuth.toBase64());
 
     AgaveTaskReply * parentReply = new AgaveTaskReply(retriveTaskGuide("fullAuth"),nullptr,this,qobject_cast<QObject *>(this));
     QMap<QString, QByteArray> taskVars;
-    parentReply->getTaskParamList()->insert("uname", uname.toLatin1());
-    parentReply->getTaskParamList()->insert("passwd", passwd.toLatin1());
-    performAgaveQuery("authStep1", taskVars, parentReply);
+    parentReply->getTaskParamList()->insert("uname", uname.toUtf8());
+    parentReply->getTaskParamList()->insert("passwd", passwd.toUtf8());
+
+    //With a client saved from an earlier login, only the token request is needed
+    usingCachedClient = loadClientCredentials();
+    if (usingCachedClient)
+    {
+        qCDebug(remoteInterface, "Using saved client credentials.");
+        setClientEncoded();
+
+        taskVars.insert("authUname", authUname.toUtf8());
+        taskVars.insert("authPass", authPass.toUtf8());
+        performAgaveQuery("authStep3", taskVars, parentReply);
+    }
+    else
+    {
+        performAgaveQuery("authStep1", taskVars, parentReply);
+    }
+
+    return qobject_cast<RemoteDataReply *>(parentReply);
+}
+
+RemoteDataReply * AgaveHandler::resumeSession(QString uname)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        return submitRequest([=]() { return resumeSession(uname); });
+    }
+
+    if (currentState != RemoteDataInterfaceState::READY_TO_AUTH)
+    {
+        qCDebug(remoteInterface, "Session resume attempted in wrong state.");
+        return createDirectReply("fullAuth", RequestState::INVALID_STATE);
+    }
+
+    authUname = uname;
+    QJsonObject sessionEntry;
+    if (!sessionStoreFile.isEmpty())
+    {
+        sessionEntry = readPrivateStore(sessionStoreFile).value(clientCredentialKey()).toObject();
+    }
+
+    QByteArray savedToken = sessionEntry.value("token").toString().toLatin1();
+    QByteArray savedRefreshToken = sessionEntry.value("refreshToken").toString().toLatin1();
+    QString savedKey = sessionEntry.value("consumerKey").toString();
+    QString savedSecret = sessionEntry.value("consumerSecret").toString();
+
+    if (savedToken.isEmpty() || savedRefreshToken.isEmpty() || savedKey.isEmpty() || savedSecret.isEmpty())
+    {
+        qCDebug(remoteInterface, "No saved session to resume.");
+        authUname = "";
+        return createDirectReply("fullAuth", RequestState::NOT_READY);
+    }
+
+    clientKey = savedKey;
+    clientSecret = savedSecret;
+    setClientEncoded();
+    refreshToken = savedRefreshToken;
+
+    qint64 remainingLife = static_cast<qint64>(sessionEntry.value("expires").toDouble()) - QDateTime::currentSecsSinceEpoch();
+    if (remainingLife > 300)
+    {
+        qCDebug(remoteInterface, "Resuming saved session.");
+        token = savedToken;
+        tokenHeader = (QString("Bearer ").append(token)).toLatin1();
+
+        changeAuthState(RemoteDataInterfaceState::CONNECTED);
+        scheduleTokenRefresh(remainingLife);
+        return createDirectReply("fullAuth", RequestState::GOOD);
+    }
+
+    //Too close to expiry to be worth using, so a new token is fetched first
+    qCDebug(remoteInterface, "Resuming saved session with token refresh.");
+    changeAuthState(RemoteDataInterfaceState::AUTH_TRY);
+
+    AgaveTaskReply * parentReply = new AgaveTaskReply(retriveTaskGuide("fullAuth"),nullptr,this,qobject_cast<QObject *>(this));
+    QMap<QString, QByteArray> taskVars;
+    taskVars.insert("token", refreshToken);
+    performAgaveQuery("authRefresh", taskVars, parentReply);
 
     return qobject_cast<RemoteDataReply *>(parentReply);
 }
@@ -144,11 +282,7 @@ RemoteDataReply * AgaveHandler::remoteLS(QString dirPath)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "remoteLS", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, dirPath));
-        return retVal;
+        return submitRequest([=]() { return remoteLS(dirPath); });
     }
 
     if ((dirPath.isEmpty()) || (dirPath == ""))
@@ -156,10 +290,10 @@ RemoteDataReply * AgaveHandler::remoteLS(QString dirPath)
         dirPath = "/";
     }
     if (!remotePathStringIsValid(dirPath)) return createDirectReply("dirListing", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("dirListing", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("dirListing", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("dirPath", dirPath.toLatin1());
+    taskVars.insert("dirPath", dirPath.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("dirListing", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -169,18 +303,14 @@ RemoteDataReply * AgaveHandler::deleteFile(QString toDelete)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "deleteFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, toDelete));
-        return retVal;
+        return submitRequest([=]() { return deleteFile(toDelete); });
     }
 
     if (!remotePathStringIsValid(toDelete)) return createDirectReply("fileDelete", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("fileDelete", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("fileDelete", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("toDelete", toDelete.toLatin1());
+    taskVars.insert("toDelete", toDelete.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("fileDelete", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -190,21 +320,16 @@ RemoteDataReply * AgaveHandler::moveFile(QString from, QString to)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "moveFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, from),
-                                  Q_ARG(QString, to));
-        return retVal;
+        return submitRequest([=]() { return moveFile(from, to); });
     }
 
     if (!remotePathStringIsValid(from)) return createDirectReply("fileMove", RequestState::INVALID_PARAM);
     if (!remotePathStringIsValid(to)) return createDirectReply("fileMove", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("fileMove", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("fileMove", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("from", from.toLatin1());
-    taskVars.insert("to", to.toLatin1());
+    taskVars.insert("from", from.toUtf8());
+    taskVars.insert("to", to.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("fileMove", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -214,21 +339,16 @@ RemoteDataReply * AgaveHandler::copyFile(QString from, QString to)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "copyFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, from),
-                                  Q_ARG(QString, to));
-        return retVal;
+        return submitRequest([=]() { return copyFile(from, to); });
     }
 
     if (!remotePathStringIsValid(from)) return createDirectReply("fileCopy", RequestState::INVALID_PARAM);
     if (!remotePathStringIsValid(to)) return createDirectReply("fileCopy", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("fileCopy", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("fileCopy", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("from", from.toLatin1());
-    taskVars.insert("to", to.toLatin1());
+    taskVars.insert("from", from.toUtf8());
+    taskVars.insert("to", to.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("fileCopy", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -238,21 +358,16 @@ RemoteDataReply * AgaveHandler::renameFile(QString fullName, QString newName)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "renameFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, fullName),
-                                  Q_ARG(QString, newName));
-        return retVal;
+        return submitRequest([=]() { return renameFile(fullName, newName); });
     }
 
     if (!remotePathStringIsValid(fullName)) return createDirectReply("renameFile", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("renameFile", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("renameFile", RequestState::INVALID_STATE);
     //TODO: check newName is valid
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("fullName", fullName.toLatin1());
-    taskVars.insert("newName", newName.toLatin1());
+    taskVars.insert("fullName", fullName.toUtf8());
+    taskVars.insert("newName", newName.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("renameFile", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -262,21 +377,16 @@ RemoteDataReply * AgaveHandler::mkRemoteDir(QString location, QString newName)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "mkRemoteDir", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, location),
-                                  Q_ARG(QString, newName));
-        return retVal;
+        return submitRequest([=]() { return mkRemoteDir(location, newName); });
     }
 
     if (!remotePathStringIsValid(location)) return createDirectReply("newFolder", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("newFolder", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("newFolder", RequestState::INVALID_STATE);
     //TODO: check newName is valid
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("location", location.toLatin1());
-    taskVars.insert("newName", newName.toLatin1());
+    taskVars.insert("location", location.toUtf8());
+    taskVars.insert("newName", newName.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("newFolder", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -286,21 +396,16 @@ RemoteDataReply * AgaveHandler::uploadFile(QString location, QString localFileNa
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "uploadFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, location),
-                                  Q_ARG(QString, localFileName));
-        return retVal;
+        return submitRequest([=]() { return uploadFile(location, localFileName); });
     }
 
     if (!remotePathStringIsValid(location)) return createDirectReply("fileUpload", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("fileUpload", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("fileUpload", RequestState::INVALID_STATE);
     //TODO: check that local file exists
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("location", location.toLatin1());
-    taskVars.insert("localFileName", localFileName.toLatin1());
+    taskVars.insert("location", location.toUtf8());
+    taskVars.insert("localFileName", localFileName.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("fileUpload", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -310,47 +415,72 @@ RemoteDataReply * AgaveHandler::uploadBuffer(QString location, QByteArray fileDa
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "uploadBuffer", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, location),
-                                  Q_ARG(QByteArray, fileData),
-                                  Q_ARG(QString, newFileName));
-        return retVal;
+        return submitRequest([=]() { return uploadBuffer(location, fileData, newFileName); });
     }
 
     if (!remotePathStringIsValid(location)) return createDirectReply("filePipeUpload", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("filePipeUpload", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("filePipeUpload", RequestState::INVALID_STATE);
     //TODO: check newFileName is valid
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("location", location.toLatin1());
-    taskVars.insert("newFileName", newFileName.toLatin1());
+    taskVars.insert("location", location.toUtf8());
+    taskVars.insert("newFileName", newFileName.toUtf8());
     taskVars.insert("fileData", fileData);
 
     AgaveTaskReply * theReply = performAgaveQuery("filePipeUpload",taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
 }
 
+RemoteDataReply * AgaveHandler::uploadStream(QString location, QIODevice * dataSource, QString newFileName, qint64 expectedSize)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        return submitRequest([=]() { return uploadStream(location, dataSource, newFileName, expectedSize); });
+    }
+
+    if (!remotePathStringIsValid(location)) return createDirectReply("fileStreamUpload", RequestState::INVALID_PARAM);
+    if ((dataSource == nullptr) || !dataSource->isReadable() || (expectedSize < 0)) return createDirectReply("fileStreamUpload", RequestState::INVALID_PARAM);
+    if (!acceptingRequests()) return createDirectReply("fileStreamUpload", RequestState::INVALID_STATE);
+
+    QMap<QString, QByteArray> taskVars;
+    taskVars.insert("location", location.toUtf8());
+    taskVars.insert("newFileName", newFileName.toUtf8());
+    taskVars.insert("expectedSize", QByteArray::number(expectedSize));
+
+    AgaveTaskReply * theReply = performAgaveQuery("fileStreamUpload", taskVars, nullptr, dataSource);
+    return qobject_cast<RemoteDataReply *>(theReply);
+}
+
 RemoteDataReply * AgaveHandler::downloadFile(QString localDest, QString remoteName)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "downloadFile", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, localDest),
-                                  Q_ARG(QString, remoteName));
-        return retVal;
+        return submitRequest([=]() { return downloadFile(localDest, remoteName); });
     }
 
     if (!remotePathStringIsValid(remoteName)) return createDirectReply("fileDownload", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("fileDownload", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("fileDownload", RequestState::INVALID_STATE);
     //TODO: check localDest exists
 
+    //The segment engine sends its range requests directly, so it cannot wait for a login in progress
+    if ((downloadSegmentCount > 1) && (currentState == RemoteDataInterfaceState::CONNECTED))
+    {
+        AgaveTaskReply * parentReply = new AgaveTaskReply(retriveTaskGuide("fileSegmentedDownload"),nullptr,this,qobject_cast<QObject *>(this));
+        parentReply->getTaskParamList()->insert("remoteName", remoteName.toUtf8());
+        parentReply->getTaskParamList()->insert("localDest", localDest.toUtf8());
+
+        AgaveSegmentedDownload * segmentEngine = new AgaveSegmentedDownload(this, remoteName, localDest, downloadSegmentCount, parentReply);
+        QObject::connect(segmentEngine, SIGNAL(segmentStats(int,qint64,qint64)), parentReply, SIGNAL(haveDownloadSegmentStats(int,qint64,qint64)));
+        QObject::connect(segmentEngine, SIGNAL(downloadDone(RequestState)), parentReply, SLOT(rawSegmentedDownloadComplete(RequestState)));
+        //Started from the event loop, so the caller can connect to the reply first
+        QMetaObject::invokeMethod(segmentEngine, "start", Qt::QueuedConnection);
+
+        return qobject_cast<RemoteDataReply *>(parentReply);
+    }
+
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("remoteName", remoteName.toLatin1());
-    taskVars.insert("localDest", localDest.toLatin1());
+    taskVars.insert("remoteName", remoteName.toUtf8());
+    taskVars.insert("localDest", localDest.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("fileDownload", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -360,25 +490,60 @@ RemoteDataReply * AgaveHandler::downloadBuffer(QString remoteName)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "downloadBuffer", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, remoteName));
-        return retVal;
+        return submitRequest([=]() { return downloadBuffer(remoteName); });
     }
 
     if (!remotePathStringIsValid(remoteName)) return createDirectReply("filePipeDownload", RequestState::INVALID_PARAM);
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("filePipeDownload", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("filePipeDownload", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("remoteName", remoteName.toLatin1());
+    taskVars.insert("remoteName", remoteName.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("filePipeDownload", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
 }
 
+RemoteDataReply * AgaveHandler::downloadBufferRange(QString remoteName, qint64 offset, qint64 length)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        return submitRequest([=]() { return downloadBufferRange(remoteName, offset, length); });
+    }
+
+    if (!remotePathStringIsValid(remoteName)) return createDirectReply("filePipeRangeDownload", RequestState::INVALID_PARAM);
+    if ((offset < 0) || (length <= 0)) return createDirectReply("filePipeRangeDownload", RequestState::INVALID_PARAM);
+    if (!acceptingRequests()) return createDirectReply("filePipeRangeDownload", RequestState::INVALID_STATE);
+
+    QMap<QString, QByteArray> taskVars;
+    taskVars.insert("remoteName", remoteName.toUtf8());
+    taskVars.insert("rangeStart", QByteArray::number(offset));
+    taskVars.insert("rangeEnd", QByteArray::number(offset + length - 1));
+
+    AgaveTaskReply * theReply = performAgaveQuery("filePipeRangeDownload", taskVars);
+    return qobject_cast<RemoteDataReply *>(theReply);
+}
+
+RemoteDataReply * AgaveHandler::downloadToDevice(QString remoteName, QIODevice * sink)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        return submitRequest([=]() { return downloadToDevice(remoteName, sink); });
+    }
+
+    if (!remotePathStringIsValid(remoteName)) return createDirectReply("fileSinkDownload", RequestState::INVALID_PARAM);
+    if ((sink != nullptr) && !sink->isWritable()) return createDirectReply("fileSinkDownload", RequestState::INVALID_PARAM);
+    if (!acceptingRequests()) return createDirectReply("fileSinkDownload", RequestState::INVALID_STATE);
+
+    QMap<QString, QByteArray> taskVars;
+    taskVars.insert("remoteName", remoteName.toUtf8());
+
+    AgaveTaskReply * theReply = performAgaveQuery("fileSinkDownload", taskVars, nullptr, sink);
+    return qobject_cast<RemoteDataReply *>(theReply);
+}
+
 AgaveTaskReply * AgaveHandler::getAgaveAppList()
 {
+    //For debugging only, and the AgaveTaskReply itself is needed for haveAgaveAppList, so this still waits
     if (QThread::currentThread() != this->thread())
     {
         AgaveTaskReply * retVal = nullptr;
@@ -387,7 +552,7 @@ AgaveTaskReply * AgaveHandler::getAgaveAppList()
         return retVal;
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("getAgaveList", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("getAgaveList", RequestState::INVALID_STATE);
 
     return performAgaveQuery("getAgaveList");
 }
@@ -396,7 +561,7 @@ void AgaveHandler::setAgaveConnectionParams(QString tenant, QString clientId, QS
 {
     if (QThread::currentThread() != this->thread())
     {
-        QMetaObject::invokeMethod(this, "setAgaveConnectionParams", Qt::BlockingQueuedConnection,
+        QMetaObject::invokeMethod(this, "setAgaveConnectionParams", Qt::QueuedConnection,
                                   Q_ARG(QString, tenant),
                                   Q_ARG(QString, clientId),
                                   Q_ARG(QString, storage));
@@ -415,6 +580,16 @@ void AgaveHandler::setAgaveConnectionParams(QString tenant, QString clientId, QS
 
     setupTaskGuideList();
 
+    loadSessionTicket();
+
+    //The TLS handshake is done while the user is still typing their password
+    QUrl tenantAddress(tenantURL);
+    if (tenantAddress.scheme() == "https")
+    {
+        qCDebug(remoteInterface, "Pre-connecting to %s", qPrintable(tenantAddress.host()));
+        networkHandle->connectToHostEncrypted(tenantAddress.host(), static_cast<quint16>(tenantAddress.port(443)), SSLoptions);
+    }
+
     changeAuthState(RemoteDataInterfaceState::READY_TO_AUTH);
 }
 
@@ -422,18 +597,10 @@ RemoteDataReply * AgaveHandler::runRemoteJob(QString jobName, ParamMap jobParame
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "runRemoteJob", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, jobName),
-                                  Q_ARG(ParamMap, jobParameters),
-                                  Q_ARG(QString, remoteWorkingDir),
-                                  Q_ARG(QString, indivJobName),
-                                  Q_ARG(QString, archivePath));
-        return retVal;
+        return submitRequest([=]() { return runRemoteJob(jobName, jobParameters, remoteWorkingDir, indivJobName, archivePath); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("agaveAppStart", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("agaveAppStart", RequestState::INVALID_STATE);
 
     //This function is only for Agave Jobs
     AgaveTaskGuide * guideToCheck = retriveTaskGuide(jobName);
@@ -479,17 +646,17 @@ RemoteDataReply * AgaveHandler::runRemoteJob(QString jobName, ParamMap jobParame
     QStringList expectedParams = guideToCheck->getAgaveParamList();
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("jobName", jobName.toLatin1());
+    taskVars.insert("jobName", jobName.toUtf8());
 
     if ((!guideToCheck->getAgavePWDparam().isEmpty()) && (!remoteWorkingDir.isEmpty()))
     {
         jobParameters.insert(guideToCheck->getAgavePWDparam(),remoteWorkingDir);
-        taskVars.insert("remoteWorkingDir", remoteWorkingDir.toLatin1());
+        taskVars.insert("remoteWorkingDir", remoteWorkingDir.toUtf8());
     }
 
     for (auto itr = jobParameters.cbegin(); itr != jobParameters.cend(); itr++)
     {
-        taskVars.insert(itr.key(), (*itr).toLatin1());
+        taskVars.insert(itr.key(), (*itr).toUtf8());
 
         QJsonObject * objectToAddTo;
 
@@ -529,14 +696,10 @@ RemoteDataReply * AgaveHandler::runAgaveJob(QJsonDocument rawJobJSON)
 {
     if (QThread::currentThread() != this->thread())
     {
-        AgaveTaskReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "runAgaveJob", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(AgaveTaskReply *, retVal),
-                                  Q_ARG(QJsonDocument, rawJobJSON));
-        return retVal;
+        return submitRequest([=]() { return runAgaveJob(rawJobJSON); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("agaveAppStart", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("agaveAppStart", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
 
@@ -553,13 +716,10 @@ RemoteDataReply * AgaveHandler::getListOfJobs()
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "getListOfJobs", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal));
-        return retVal;
+        return submitRequest([=]() { return getListOfJobs(); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("getJobList", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("getJobList", RequestState::INVALID_STATE);
 
     return qobject_cast<RemoteDataReply *>(performAgaveQuery("getJobList"));
 }
@@ -568,17 +728,13 @@ RemoteDataReply * AgaveHandler::getJobDetails(QString IDstr)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "getJobDetails", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, IDstr));
-        return retVal;
+        return submitRequest([=]() { return getJobDetails(IDstr); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("getJobDetails", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("getJobDetails", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("IDstr", IDstr.toLatin1());
+    taskVars.insert("IDstr", IDstr.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("getJobDetails", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -588,17 +744,13 @@ RemoteDataReply * AgaveHandler::stopJob(QString IDstr)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "stopJob", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, IDstr));
-        return retVal;
+        return submitRequest([=]() { return stopJob(IDstr); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("stopJob", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("stopJob", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("IDstr", IDstr.toLatin1());
+    taskVars.insert("IDstr", IDstr.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("stopJob", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -608,17 +760,13 @@ RemoteDataReply * AgaveHandler::deleteJob(QString IDstr)
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "deleteJob", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal),
-                                  Q_ARG(QString, IDstr));
-        return retVal;
+        return submitRequest([=]() { return deleteJob(IDstr); });
     }
 
-    if (currentState != RemoteDataInterfaceState::CONNECTED) return createDirectReply("deleteJob", RequestState::INVALID_STATE);
+    if (!acceptingRequests()) return createDirectReply("deleteJob", RequestState::INVALID_STATE);
 
     QMap<QString, QByteArray> taskVars;
-    taskVars.insert("IDstr", IDstr.toLatin1());
+    taskVars.insert("IDstr", IDstr.toUtf8());
 
     AgaveTaskReply * theReply = performAgaveQuery("deleteJob", taskVars);
     return qobject_cast<RemoteDataReply *>(theReply);
@@ -626,22 +774,14 @@ RemoteDataReply * AgaveHandler::deleteJob(QString IDstr)
 
 RemoteDataInterfaceState AgaveHandler::getInterfaceState()
 {
-    if (QThread::currentThread() != this->thread())
-    {
-        RemoteDataInterfaceState retVal;
-        QMetaObject::invokeMethod(this, "getInterfaceState", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataInterfaceState, retVal));
-        return retVal;
-    }
-
-    return currentState;
+    return static_cast<RemoteDataInterfaceState>(stateSnapshot.loadAcquire());
 }
 
 void AgaveHandler::registerAgaveAppInfo(QString agaveAppName, QString fullAgaveName, QStringList parameterList, QStringList inputList, QString workingDirParameter)
 {
     if (QThread::currentThread() != this->thread())
     {
-        QMetaObject::invokeMethod(this, "registerAgaveAppInfo", Qt::BlockingQueuedConnection,
+        QMetaObject::invokeMethod(this, "registerAgaveAppInfo", Qt::QueuedConnection,
                                   Q_ARG(QString, agaveAppName),
                                   Q_ARG(QString, fullAgaveName),
                                   Q_ARG(QStringList, parameterList),
@@ -651,7 +791,7 @@ void AgaveHandler::registerAgaveAppInfo(QString agaveAppName, QString fullAgaveN
     }
 
     qCDebug(remoteInterface, "Registering Agave ID: %s", qPrintable(fullAgaveName));
-    AgaveTaskGuide * toInsert = new AgaveTaskGuide(agaveAppName, AgaveRequestType::AGAVE_APP);
+    AgaveTaskGuide * toInsert = new AgaveTaskGuide(agaveAppName, AgaveRequestType::AGAVE_APP, AgaveTaskKind::JOB_START);
     toInsert->setAgaveFullName(fullAgaveName);
     toInsert->setAgaveParamList(parameterList);
     toInsert->setAgaveInputList(inputList);
@@ -663,10 +803,7 @@ RemoteDataReply * AgaveHandler::closeAllConnections()
 {
     if (QThread::currentThread() != this->thread())
     {
-        RemoteDataReply * retVal = nullptr;
-        QMetaObject::invokeMethod(this, "closeAllConnections", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(RemoteDataReply *, retVal));
-        return retVal;
+        return submitRequest([=]() { return closeAllConnections(); });
     }
 
     if ((currentState == RemoteDataInterfaceState::INIT) || (currentState == RemoteDataInterfaceState::READY_TO_AUTH) ||
@@ -698,6 +835,8 @@ RemoteDataReply * AgaveHandler::closeAllConnections()
     }
 
     qCDebug(remoteInterface, "Closing agave connection.");
+    //The token is about to be revoked, so it is no use to a later process
+    forgetSession();
     changeAuthState(RemoteDataInterfaceState::DISCONNECTING);
 
     QMap<QString, QByteArray> taskVars;
@@ -715,6 +854,15 @@ RemoteDataReply * AgaveHandler::closeAllConnections()
     return createDirectReply("startedLogout", RequestState::GOOD);
 }
 
+void AgaveHandler::setClientEncoded()
+{
+    clientEncoded = "Basic ";
+    QByteArray rawAuth(clientKey.toLatin1());
+    rawAuth.append(":");
+    rawAuth.append(clientSecret);
+    clientEncoded.append(rawAuth.toBase64());
+}
+
 void AgaveHandler::changeAuthState(RemoteDataInterfaceState newState)
 {
     currentState = newState;
@@ -734,158 +882,491 @@ void AgaveHandler::changeAuthState(RemoteDataInterfaceState newState)
         clientSecret = "";
     }
 
+    if (currentState == RemoteDataInterfaceState::CONNECTED)
+    {
+        releaseAuthWaiters(RequestState::GOOD);
+    }
+    else if ((currentState != RemoteDataInterfaceState::AUTH_TRY) && (currentState != RemoteDataInterfaceState::READY_TO_AUTH))
+    {
+        //A failed login gives its own error, through forwardReplyToParent
+        releaseAuthWaiters(RequestState::INVALID_STATE);
+    }
+
+    if (currentState != RemoteDataInterfaceState::CONNECTED)
+    {
+        tokenRefreshTimer->stop();
+        if (tokenRefreshPending || !tokenWaitList.isEmpty() || !rawTokenWaitList.isEmpty())
+        {
+            finishTokenRefresh(RequestState::INVALID_STATE);
+        }
+    }
+
+    publishStateSnapshot();
     emit connectionStateChanged(currentState);
 }
 
-void AgaveHandler::setupTaskGuideList()
+void AgaveHandler::publishStateSnapshot()
 {
-    AgaveTaskGuide * toInsert = nullptr;
+    stateSnapshot.storeRelease(static_cast<int>(currentState));
 
-    toInsert = new AgaveTaskGuide("fullAuth", AgaveRequestType::AGAVE_NONE);
-    insertAgaveTaskGuide(toInsert);
-
-    toInsert = new AgaveTaskGuide("startedLogout", AgaveRequestType::AGAVE_NONE);
-    insertAgaveTaskGuide(toInsert);
+    QString connectedName;
+    if (currentState == RemoteDataInterfaceState::CONNECTED)
+    {
+        connectedName = authUname;
+    }
+    const QString * oldName = userNameSnapshot.loadAcquire();
+    if ((oldName != nullptr) && (*oldName == connectedName)) return;
 
-    toInsert = new AgaveTaskGuide("authStep1", AgaveRequestType::AGAVE_GET);
-    toInsert->setURLsuffix(QString("/clients/v2/%1").arg(clientName));
-    toInsert->setHeaderType(AuthHeaderType::PASSWD);
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+    //Old names are only deleted with the handler, as another thread may still be copying one
+    QString * newName = new QString(connectedName);
+    userNameSnapshots.append(newName);
+    userNameSnapshot.storeRelease(newName);
+}
 
-    toInsert = new AgaveTaskGuide("authStep1a", AgaveRequestType::AGAVE_DELETE);
-    toInsert->setURLsuffix(QString("/clients/v2/%1").arg(clientName));
-    toInsert->setHeaderType(AuthHeaderType::PASSWD);
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::deferReply(AgaveTaskReply * theReply)
+{
+    deferredReplies.append(theReply);
+    if (deferredDeliveryScheduled) return;
+    deferredDeliveryScheduled = true;
+    QMetaObject::invokeMethod(this, "deliverDeferredReplies", Qt::QueuedConnection);
+}
 
-    toInsert = new AgaveTaskGuide("authStep2", AgaveRequestType::AGAVE_POST);
-    toInsert->setURLsuffix(QString("/clients/v2/"));
-    toInsert->setHeaderType(AuthHeaderType::PASSWD);
-    toInsert->setPostParams(QString("clientName=%1&description=Client ID for SimCenter Wind GUI App").arg(clientName));
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::deliverDeferredReplies()
+{
+    deferredDeliveryScheduled = false;
 
-    toInsert = new AgaveTaskGuide("authStep3", AgaveRequestType::AGAVE_POST);
-    toInsert->setURLsuffix(QString("/token"));
-    toInsert->setHeaderType(AuthHeaderType::CLIENT);
-    toInsert->setPostParams("username=%1&password=%2&grant_type=password&scope=PRODUCTION", {"authUname", "authPass"});
-    toInsert->setTokenFormat(true);
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+    //Replies deferred while delivering wait for the next pass
+    QList<QPointer<AgaveTaskReply>> toDeliver;
+    toDeliver.swap(deferredReplies);
+    for (const QPointer<AgaveTaskReply> &aReply : toDeliver)
+    {
+        if (aReply.isNull()) continue;
+        aReply->rawPassThruTaskComplete();
+    }
+}
 
-    toInsert = new AgaveTaskGuide("authRefresh", AgaveRequestType::AGAVE_POST);
-    toInsert->setURLsuffix(QString("/token"));
-    toInsert->setHeaderType(AuthHeaderType::CLIENT);
-    toInsert->setPostParams("grant_type=refresh_token&scope=PRODUCTION&refresh_token=%1",{"token"});
-    toInsert->setTokenFormat(true);
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+RemoteDataReply * AgaveHandler::submitRequest(std::function<RemoteDataReply *()> requestCall)
+{
+    AgaveReplyProxy * proxyReply = new AgaveReplyProxy();
+    proxyReply->moveToThread(this->thread());
 
-    toInsert = new AgaveTaskGuide("authRevoke", AgaveRequestType::AGAVE_POST);
-    toInsert->setURLsuffix(QString("/revoke"));
-    toInsert->setHeaderType(AuthHeaderType::CLIENT);
-    toInsert->setPostParams("token=%1",{"token"});
-    toInsert->setAsInternal();
-    insertAgaveTaskGuide(toInsert);
+    PendingSubmission newSubmission;
+    newSubmission.proxyReply = proxyReply;
+    newSubmission.requestCall = requestCall;
 
-    toInsert = new AgaveTaskGuide("dirListing", AgaveRequestType::AGAVE_GET);
-    toInsert->setURLsuffix((QString("/files/v2/listings/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"dirPath"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    submissionLock.lock();
+    bool needsProcessing = submissionQueue.isEmpty();
+    submissionQueue.append(newSubmission);
+    submissionLock.unlock();
 
-    toInsert = new AgaveTaskGuide("fileUpload", AgaveRequestType::AGAVE_UPLOAD);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"location"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    if (needsProcessing)
+    {
+        QMetaObject::invokeMethod(this, "processSubmissions", Qt::QueuedConnection);
+    }
+    return proxyReply;
+}
 
-    toInsert = new AgaveTaskGuide("fileDownload", AgaveRequestType::AGAVE_DOWNLOAD);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    //toInsert->setURLsuffix(QString("/files/v2/media/"));
-    toInsert->setDynamicURLParams("%1",{"remoteName"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::processSubmissions()
+{
+    QList<PendingSubmission> toRun;
+    submissionLock.lock();
+    toRun.swap(submissionQueue);
+    submissionLock.unlock();
 
-    toInsert = new AgaveTaskGuide("filePipeUpload", AgaveRequestType::AGAVE_PIPE_UPLOAD);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"location"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    //The proxy holds the signals of the reply until the caller has connected to it
+    for (PendingSubmission &aSubmission : toRun)
+    {
+        RemoteDataReply * actualReply = aSubmission.requestCall();
+        aSubmission.proxyReply->setParent(this);
+        aSubmission.proxyReply->attachRequest(actualReply);
+    }
+}
 
-    toInsert = new AgaveTaskGuide("filePipeDownload", AgaveRequestType::AGAVE_PIPE_DOWNLOAD);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"remoteName"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::setMaxRequestsInFlight(RequestPriority priorityClass, int maxCount)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setMaxRequestsInFlight", Qt::QueuedConnection,
+                                  Q_ARG(RequestPriority, priorityClass),
+                                  Q_ARG(int, maxCount));
+        return;
+    }
 
-    toInsert = new AgaveTaskGuide("fileDelete", AgaveRequestType::AGAVE_DELETE);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"toDelete"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    if (maxCount < 1)
+    {
+        qCDebug(remoteInterface, "ERROR: At least one request of each priority must be allowed in flight.");
+        return;
+    }
 
-    toInsert = new AgaveTaskGuide("newFolder", AgaveRequestType::AGAVE_PUT);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"location"});
-    toInsert->setPostParams("action=mkdir&path=%1",{"newName"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    requestScheduler->setMaxInFlight(priorityClass, maxCount);
+}
 
-    toInsert = new AgaveTaskGuide("renameFile", AgaveRequestType::AGAVE_PUT);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"fullName"});
-    toInsert->setPostParams("action=rename&path=%1",{"newName"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::setResponseCacheTTL(int msecs)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setResponseCacheTTL", Qt::QueuedConnection,
+                                  Q_ARG(int, msecs));
+        return;
+    }
 
-    toInsert = new AgaveTaskGuide("fileCopy", AgaveRequestType::AGAVE_PUT);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"from"});
-    toInsert->setPostParams("action=copy&path=%1",{"to"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    responseCache.setTimeToLive(msecs);
+}
 
-    toInsert = new AgaveTaskGuide("fileMove", AgaveRequestType::AGAVE_PUT);
-    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(storageNode));
-    toInsert->setDynamicURLParams("%1",{"from"});
-    toInsert->setPostParams("action=move&path=%1",{"to"});
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+void AgaveHandler::setRetryLimits(int maxAttempts, int maxRetriesPerMinute)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setRetryLimits", Qt::QueuedConnection,
+                                  Q_ARG(int, maxAttempts), Q_ARG(int, maxRetriesPerMinute));
+        return;
+    }
 
-    toInsert = new AgaveTaskGuide("agaveAppStart", AgaveRequestType::AGAVE_JSON_POST);
-    toInsert->setURLsuffix(QString("/jobs/v2"));
-    toInsert->setHeaderType(AuthHeaderType::TOKEN);
-    insertAgaveTaskGuide(toInsert);
+    retryPolicy.setMaxAttempts(maxAttempts);
+    retryPolicy.setRetryBudget(maxRetriesPerMinute, 60000);
+}
 
-    toInsert = new AgaveTaskGuide("getAgaveList", AgaveRequestType::AGAVE_GET);
-    toInsert->setURLsuffix(QString("/apps/v2"));
+void AgaveHandler::setRetryBackoff(int baseMsecs, int maxMsecs)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setRetryBackoff", Qt::QueuedConnection,
+                                  Q_ARG(int, baseMsecs), Q_ARG(int, maxMsecs));
+        return;
+    }
+
+    retryPolicy.setBackoff(baseMsecs, maxMsecs);
+}
+
+void AgaveHandler::setRequestDeadline(RequestPriority priorityClass, int msecs)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setRequestDeadline", Qt::QueuedConnection,
+                                  Q_ARG(RequestPriority, priorityClass),
+                                  Q_ARG(int, msecs));
+        return;
+    }
+
+    if (msecs < 0) return;
+    requestDeadlines[static_cast<int>(priorityClass)] = msecs;
+}
+
+void AgaveHandler::setStallTimeout(int msecs)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setStallTimeout", Qt::QueuedConnection,
+                                  Q_ARG(int, msecs));
+        return;
+    }
+
+    if (msecs < 0) return;
+    stallTimeout = msecs;
+}
+
+void AgaveHandler::setHttp2Enabled(bool enabled)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setHttp2Enabled", Qt::QueuedConnection,
+                                  Q_ARG(bool, enabled));
+        return;
+    }
+
+    http2Enabled = enabled;
+}
+
+void AgaveHandler::setSessionTicketFile(QString filePath)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setSessionTicketFile", Qt::QueuedConnection,
+                                  Q_ARG(QString, filePath));
+        return;
+    }
+
+    if (!privateStorePathIsValid(filePath))
+    {
+        qCDebug(remoteInterface, "ERROR: TLS session ticket file must be an absolute path below a directory.");
+        return;
+    }
+
+    ticketWriteTimer->stop();
+    pendingTicket.clear();
+    sessionTicketFile = filePath;
+    if (!tenantURL.isEmpty())
+    {
+        loadSessionTicket();
+    }
+}
+
+void AgaveHandler::setClientCredentialStore(QString filePath)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setClientCredentialStore", Qt::QueuedConnection,
+                                  Q_ARG(QString, filePath));
+        return;
+    }
+
+    if (!privateStorePathIsValid(filePath))
+    {
+        qCDebug(remoteInterface, "ERROR: Client credential store must be an absolute path below a directory.");
+        return;
+    }
+
+    credentialStoreFile = filePath;
+}
+
+void AgaveHandler::setSessionStore(QString filePath)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setSessionStore", Qt::QueuedConnection,
+                                  Q_ARG(QString, filePath));
+        return;
+    }
+
+    if (!privateStorePathIsValid(filePath))
+    {
+        qCDebug(remoteInterface, "ERROR: Session store must be an absolute path below a directory.");
+        return;
+    }
+
+    sessionStoreFile = filePath;
+}
+
+void AgaveHandler::setQueueRequestsDuringAuth(bool enabled)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setQueueRequestsDuringAuth", Qt::QueuedConnection,
+                                  Q_ARG(bool, enabled));
+        return;
+    }
+
+    queueDuringAuth = enabled;
+}
+
+void AgaveHandler::setDownloadSegmentCount(int segmentCount)
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        QMetaObject::invokeMethod(this, "setDownloadSegmentCount", Qt::QueuedConnection,
+                                  Q_ARG(int, segmentCount));
+        return;
+    }
+
+    if ((segmentCount < 1) || (segmentCount > maxDownloadSegments))
+    {
+        qCDebug(remoteInterface, "ERROR: Download segment count must be between 1 and %d.", maxDownloadSegments);
+        return;
+    }
+
+    //Segments are bulk requests, so no more of them run at once than the bulk class allows
+    int bulkLimit = requestScheduler->getMaxInFlight(RequestPriority::BULK);
+    if (segmentCount > bulkLimit)
+    {
+        qCDebug(remoteInterface, "Only %d of %d download segments will run at once, the limit for bulk requests.", bulkLimit, segmentCount);
+    }
+
+    downloadSegmentCount = segmentCount;
+}
+
+void AgaveHandler::setupTaskGuideList()
+{
+    AgaveTaskGuide * toInsert = nullptr;
+    QString encodedClientName = AgaveTaskGuide::encodeFixedValue(clientName);
+    QString encodedStorageNode = AgaveTaskGuide::encodeFixedValue(storageNode);
+
+    toInsert = new AgaveTaskGuide("fullAuth", AgaveRequestType::AGAVE_NONE, AgaveTaskKind::FULL_AUTH);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("startedLogout", AgaveRequestType::AGAVE_NONE, AgaveTaskKind::LOGOUT);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authStep1", AgaveRequestType::AGAVE_GET, AgaveTaskKind::AUTH_STEP1);
+    toInsert->setURLsuffix(QString("/clients/v2/%1").arg(encodedClientName));
+    toInsert->setHeaderType(AuthHeaderType::PASSWD);
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authStep1a", AgaveRequestType::AGAVE_DELETE, AgaveTaskKind::AUTH_STEP1A);
+    toInsert->setURLsuffix(QString("/clients/v2/%1").arg(encodedClientName));
+    toInsert->setHeaderType(AuthHeaderType::PASSWD);
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authStep2", AgaveRequestType::AGAVE_POST, AgaveTaskKind::AUTH_STEP2);
+    toInsert->setURLsuffix(QString("/clients/v2/"));
+    toInsert->setHeaderType(AuthHeaderType::PASSWD);
+    toInsert->setPostParams(QString("clientName=%1&description=%2").arg(encodedClientName,
+                            AgaveTaskGuide::encodeFixedValue("Client ID for SimCenter Wind GUI App")));
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authStep3", AgaveRequestType::AGAVE_POST, AgaveTaskKind::AUTH_STEP3);
+    toInsert->setURLsuffix(QString("/token"));
+    toInsert->setHeaderType(AuthHeaderType::CLIENT);
+    toInsert->setPostParams("username=%1&password=%2&grant_type=password&scope=PRODUCTION", {"authUname", "authPass"});
+    toInsert->setTokenFormat(true);
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authRefresh", AgaveRequestType::AGAVE_POST, AgaveTaskKind::AUTH_REFRESH);
+    toInsert->setURLsuffix(QString("/token"));
+    toInsert->setHeaderType(AuthHeaderType::CLIENT);
+    toInsert->setPostParams("grant_type=refresh_token&scope=PRODUCTION&refresh_token=%1",{"token"});
+    toInsert->setTokenFormat(true);
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("authRevoke", AgaveRequestType::AGAVE_POST, AgaveTaskKind::AUTH_REVOKE);
+    toInsert->setURLsuffix(QString("/revoke"));
+    toInsert->setHeaderType(AuthHeaderType::CLIENT);
+    toInsert->setPostParams("token=%1",{"token"});
+    toInsert->setAsInternal();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("dirListing", AgaveRequestType::AGAVE_GET, AgaveTaskKind::DIR_LISTING);
+    toInsert->setURLsuffix((QString("/files/v2/listings/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"dirPath"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setResponseCacheable();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileUpload", AgaveRequestType::AGAVE_UPLOAD, AgaveTaskKind::FILE_UPLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"location"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BULK);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileDownload", AgaveRequestType::AGAVE_DOWNLOAD, AgaveTaskKind::FILE_DOWNLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    //toInsert->setURLsuffix(QString("/files/v2/media/"));
+    toInsert->setDynamicURLParams("%1",{"remoteName"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BULK);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileSegmentedDownload", AgaveRequestType::AGAVE_NONE, AgaveTaskKind::FILE_DOWNLOAD);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("filePipeUpload", AgaveRequestType::AGAVE_PIPE_UPLOAD, AgaveTaskKind::FILE_UPLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"location"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BULK);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileStreamUpload", AgaveRequestType::AGAVE_STREAM_UPLOAD, AgaveTaskKind::FILE_UPLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"location"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BULK);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("filePipeDownload", AgaveRequestType::AGAVE_PIPE_DOWNLOAD, AgaveTaskKind::BUFFER_DOWNLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"remoteName"});
     toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BACKGROUND);
     insertAgaveTaskGuide(toInsert);
 
-    toInsert = new AgaveTaskGuide("getJobList", AgaveRequestType::AGAVE_GET);
+    toInsert = new AgaveTaskGuide("filePipeRangeDownload", AgaveRequestType::AGAVE_PIPE_DOWNLOAD, AgaveTaskKind::RANGE_DOWNLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"remoteName"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BACKGROUND);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileSinkDownload", AgaveRequestType::AGAVE_SINK_DOWNLOAD, AgaveTaskKind::FILE_DOWNLOAD);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"remoteName"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BULK);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileDelete", AgaveRequestType::AGAVE_DELETE, AgaveTaskKind::FILE_DELETE);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"toDelete"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(true);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("newFolder", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::NEW_FOLDER);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"location"});
+    toInsert->setPostParams("action=mkdir&path=%1",{"newName"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(true);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("renameFile", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::RENAME_FILE);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"fullName"});
+    toInsert->setPostParams("action=rename&path=%1",{"newName"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    //Once done, sending it again would fail or act twice, so a lost reply is reported instead
+    toInsert->setRetryable(false);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileCopy", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::FILE_COPY);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"from"});
+    toInsert->setPostParams("action=copy&path=%1",{"to"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(false);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("fileMove", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::FILE_MOVE);
+    toInsert->setURLsuffix((QString("/files/v2/media/system/%1/")).arg(encodedStorageNode));
+    toInsert->setDynamicURLParams("%1",{"from"});
+    toInsert->setPostParams("action=move&path=%1",{"to"});
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(false);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("agaveAppStart", AgaveRequestType::AGAVE_JSON_POST, AgaveTaskKind::JOB_START);
+    toInsert->setURLsuffix(QString("/jobs/v2"));
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("getAgaveList", AgaveRequestType::AGAVE_GET, AgaveTaskKind::APP_LIST);
+    toInsert->setURLsuffix(QString("/apps/v2"));
+    toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setResponseCacheable();
+    insertAgaveTaskGuide(toInsert);
+
+    toInsert = new AgaveTaskGuide("getJobList", AgaveRequestType::AGAVE_GET, AgaveTaskKind::JOB_LIST);
     toInsert->setURLsuffix(QString("/jobs/v2"));
     toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setDefaultPriority(RequestPriority::BACKGROUND);
     insertAgaveTaskGuide(toInsert);
 
-    toInsert = new AgaveTaskGuide("getJobDetails", AgaveRequestType::AGAVE_GET);
+    toInsert = new AgaveTaskGuide("getJobDetails", AgaveRequestType::AGAVE_GET, AgaveTaskKind::JOB_DETAILS);
     toInsert->setURLsuffix(QString("/jobs/v2/"));
     toInsert->setDynamicURLParams("%1",{"IDstr"});
     toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    //Job status changes without notice, so only the server may say a cached copy is current
+    toInsert->setResponseCacheable(true);
     insertAgaveTaskGuide(toInsert);
 
-    toInsert = new AgaveTaskGuide("stopJob", AgaveRequestType::AGAVE_POST);
+    toInsert = new AgaveTaskGuide("stopJob", AgaveRequestType::AGAVE_POST, AgaveTaskKind::STOP_JOB);
     toInsert->setURLsuffix(QString("/jobs/v2/"));
     toInsert->setDynamicURLParams("%1",{"IDstr"});
     toInsert->setPostParams("action=stop");
     toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(true);
     insertAgaveTaskGuide(toInsert);
 
-    toInsert = new AgaveTaskGuide("deleteJob", AgaveRequestType::AGAVE_DELETE);
+    toInsert = new AgaveTaskGuide("deleteJob", AgaveRequestType::AGAVE_DELETE, AgaveTaskKind::DELETE_JOB);
     toInsert->setURLsuffix(QString("/jobs/v2/"));
     toInsert->setDynamicURLParams("%1",{"IDstr"});
     toInsert->setHeaderType(AuthHeaderType::TOKEN);
+    toInsert->setRetryable(true);
     insertAgaveTaskGuide(toInsert);
 }
 
@@ -897,6 +1378,7 @@ void AgaveHandler::insertAgaveTaskGuide(AgaveTaskGuide * newGuide)
         qCDebug(remoteInterface, "ERROR: Invalid Task Guide List: Duplicate Name");
         return;
     }
+    newGuide->compileFormats();
     validTaskList.insert(taskName,newGuide);
 }
 
@@ -922,6 +1404,335 @@ bool AgaveHandler::remotePathStringIsValid(QString)
     return true;
 }
 
+void AgaveHandler::scheduleTokenRefresh(qint64 expiresIn)
+{
+    tokenRefreshFailures = 0;
+    tokenExpiresAt = 0;
+
+    //Without a known lifetime, the token is only refreshed when a request is refused
+    if (expiresIn <= 0) return;
+    tokenExpiresAt = QDateTime::currentSecsSinceEpoch() + expiresIn;
+
+    //Refresh ahead of expiry by a tenth of the lifetime, at most five minutes
+    qint64 refreshDelay = expiresIn - qMin<qint64>(expiresIn / 10, 300);
+    tokenRefreshTimer->start(static_cast<int>(qMin<qint64>(refreshDelay * 1000, std::numeric_limits<int>::max())));
+}
+
+void AgaveHandler::retryTokenRefresh()
+{
+    if ((currentState != RemoteDataInterfaceState::CONNECTED) || refreshToken.isEmpty() || (tokenExpiresAt <= 0)) return;
+
+    //Once the token has expired, the next refused request asks for a refresh itself
+    qint64 msecsLeft = (tokenExpiresAt - QDateTime::currentSecsSinceEpoch()) * 1000;
+    if (msecsLeft <= 0) return;
+
+    qint64 retryDelay = tokenRetryBaseDelay;
+    for (int i = 0; (i < tokenRefreshFailures) && (retryDelay < tokenRetryMaxDelay); i++)
+    {
+        retryDelay *= 2;
+    }
+    retryDelay = qMin(qMin(retryDelay, tokenRetryMaxDelay), msecsLeft);
+    tokenRefreshFailures++;
+
+    qCDebug(remoteInterface, "Trying token refresh again in %lld ms", retryDelay);
+    tokenRefreshTimer->start(static_cast<int>(retryDelay));
+}
+
+void AgaveHandler::refreshAccessToken()
+{
+    if (tokenRefreshPending) return;
+
+    if ((currentState != RemoteDataInterfaceState::CONNECTED) || refreshToken.isEmpty())
+    {
+        finishTokenRefresh(RequestState::INVALID_STATE);
+        return;
+    }
+
+    qCDebug(remoteInterface, "Refreshing access token.");
+    tokenRefreshPending = true;
+
+    QMap<QString, QByteArray> varList;
+    varList.insert("token", refreshToken);
+    performAgaveQuery("authRefresh", varList);
+}
+
+void AgaveHandler::replayAfterTokenRefresh(AgaveTaskReply * theReply)
+{
+    tokenWaitList.append(theReply);
+    refreshAccessToken();
+}
+
+void AgaveHandler::waitForTokenRefresh(QObject * waiter, std::function<void(RequestState)> resumeCall)
+{
+    TokenWaiter newWaiter;
+    newWaiter.waiter = waiter;
+    newWaiter.resumeCall = resumeCall;
+    rawTokenWaitList.append(newWaiter);
+    refreshAccessToken();
+}
+
+void AgaveHandler::failTokenRefresh(AgaveTaskReply * agaveReply, RequestState failState, bool grantRefused)
+{
+    //Only a refresh token the server has refused is of no further use
+    //After a network error or a garbled reply, the saved session may still be resumed later
+    if (grantRefused)
+    {
+        forgetSession();
+    }
+
+    if (qobject_cast<AgaveTaskReply *>(agaveReply->parent()) == nullptr)
+    {
+        finishTokenRefresh(failState);
+        //A refused grant will not be accepted later either
+        if (!grantRefused)
+        {
+            retryTokenRefresh();
+        }
+        return;
+    }
+    if (currentState == RemoteDataInterfaceState::CANCEL_AUTH)
+    {
+        changeAuthState(RemoteDataInterfaceState::DISCONNECTED);
+    }
+    else
+    {
+        changeAuthState(RemoteDataInterfaceState::READY_TO_AUTH);
+    }
+    forwardReplyToParent(agaveReply, failState);
+}
+
+bool AgaveHandler::acceptingRequests()
+{
+    if (currentState == RemoteDataInterfaceState::CONNECTED) return true;
+    return (queueDuringAuth && (currentState == RemoteDataInterfaceState::AUTH_TRY));
+}
+
+void AgaveHandler::releaseAuthWaiters(RequestState loginState)
+{
+    if (authWaitList.isEmpty()) return;
+
+    QList<QPointer<AgaveTaskReply>> waitingReplies = authWaitList;
+    authWaitList.clear();
+    for (QPointer<AgaveTaskReply> aReply : waitingReplies)
+    {
+        if (aReply.isNull()) continue;
+
+        if (loginState == RequestState::GOOD)
+        {
+            requestScheduler->enqueueRequest(aReply);
+        }
+        else
+        {
+            aReply->giveFailedReply(loginState);
+        }
+    }
+}
+
+void AgaveHandler::finishTokenRefresh(RequestState refreshState)
+{
+    tokenRefreshPending = false;
+    if (refreshState != RequestState::GOOD)
+    {
+        qCDebug(remoteInterface, "Unable to refresh access token: %s", qPrintable(interpretRequestState(refreshState)));
+    }
+
+    QList<QPointer<AgaveTaskReply>> waitingReplies = tokenWaitList;
+    tokenWaitList.clear();
+    for (QPointer<AgaveTaskReply> aReply : waitingReplies)
+    {
+        if (aReply.isNull()) continue;
+
+        if (refreshState == RequestState::GOOD)
+        {
+            requestScheduler->enqueueRequest(aReply);
+        }
+        else
+        {
+            //The original refusal is what the caller would have seen without a refresh
+            aReply->giveFailedReply(RequestState::REMOTE_SERVER_ERROR);
+        }
+    }
+
+    QList<TokenWaiter> waitingCalls;
+    waitingCalls.swap(rawTokenWaitList);
+    for (const TokenWaiter &aWaiter : waitingCalls)
+    {
+        if (aWaiter.waiter.isNull()) continue;
+        aWaiter.resumeCall(refreshState);
+    }
+}
+
+void AgaveHandler::loadSessionTicket()
+{
+    if (sessionTicketFile.isEmpty()) return;
+
+    QJsonObject ticketList = readPrivateStore(sessionTicketFile);
+    QJsonObject tenantEntry = ticketList.value(tenantURL).toObject();
+    if (tenantEntry.isEmpty()) return;
+    if (QDateTime::currentSecsSinceEpoch() >= static_cast<qint64>(tenantEntry.value("expires").toDouble())) return;
+
+    QByteArray savedTicket = QByteArray::fromBase64(tenantEntry.value("ticket").toString().toLatin1());
+    if (savedTicket.isEmpty()) return;
+
+    qCDebug(remoteInterface, "Reusing saved TLS session for %s", qPrintable(tenantURL));
+    SSLoptions.setSessionTicket(savedTicket);
+}
+
+void AgaveHandler::storeSessionTicket(QByteArray newTicket, int lifeTimeHint)
+{
+    if (sessionTicketFile.isEmpty() || tenantURL.isEmpty()) return;
+
+    //Servers that give no hint still expect tickets to be short lived
+    if (lifeTimeHint <= 0) lifeTimeHint = 7200;
+
+    //Tickets may be renewed often, so only the latest is written, once the timer runs out
+    pendingTicket = newTicket;
+    pendingTicketExpiry = QDateTime::currentSecsSinceEpoch() + lifeTimeHint;
+    if (!ticketWriteTimer->isActive())
+    {
+        ticketWriteTimer->start();
+    }
+}
+
+void AgaveHandler::writeSessionTicket()
+{
+    ticketWriteTimer->stop();
+    if (pendingTicket.isEmpty() || sessionTicketFile.isEmpty()) return;
+
+    QJsonObject ticketList = readPrivateStore(sessionTicketFile);
+
+    QJsonObject tenantEntry;
+    tenantEntry.insert("ticket", QString::fromLatin1(pendingTicket.toBase64()));
+    tenantEntry.insert("expires", static_cast<double>(pendingTicketExpiry));
+    ticketList.insert(tenantURL, tenantEntry);
+    pendingTicket.clear();
+
+    writePrivateStore(sessionTicketFile, ticketList);
+}
+
+QString AgaveHandler::clientCredentialKey()
+{
+    return QString("%1|%2|%3").arg(tenantURL, clientName, authUname);
+}
+
+bool AgaveHandler::loadClientCredentials()
+{
+    if (credentialStoreFile.isEmpty()) return false;
+
+    QJsonObject clientEntry = readPrivateStore(credentialStoreFile).value(clientCredentialKey()).toObject();
+    QString savedKey = clientEntry.value("consumerKey").toString();
+    QString savedSecret = clientEntry.value("consumerSecret").toString();
+    if (savedKey.isEmpty() || savedSecret.isEmpty()) return false;
+
+    clientKey = savedKey;
+    clientSecret = savedSecret;
+    return true;
+}
+
+void AgaveHandler::storeClientCredentials()
+{
+    if (credentialStoreFile.isEmpty()) return;
+
+    QJsonObject clientList = readPrivateStore(credentialStoreFile);
+
+    QJsonObject clientEntry;
+    clientEntry.insert("consumerKey", clientKey);
+    clientEntry.insert("consumerSecret", clientSecret);
+    clientList.insert(clientCredentialKey(), clientEntry);
+
+    writePrivateStore(credentialStoreFile, clientList);
+}
+
+void AgaveHandler::forgetClientCredentials()
+{
+    if (credentialStoreFile.isEmpty()) return;
+
+    QJsonObject clientList = readPrivateStore(credentialStoreFile);
+    if (!clientList.contains(clientCredentialKey())) return;
+    clientList.remove(clientCredentialKey());
+    writePrivateStore(credentialStoreFile, clientList);
+}
+
+void AgaveHandler::storeSession(qint64 expiresIn)
+{
+    if (sessionStoreFile.isEmpty()) return;
+
+    QJsonObject sessionList = readPrivateStore(sessionStoreFile);
+
+    //With no known lifetime, a resumed session refreshes its token first
+    qint64 expiresAt = QDateTime::currentSecsSinceEpoch();
+    if (expiresIn > 0) expiresAt += expiresIn;
+
+    QJsonObject sessionEntry;
+    sessionEntry.insert("token", QString::fromLatin1(token));
+    sessionEntry.insert("refreshToken", QString::fromLatin1(refreshToken));
+    sessionEntry.insert("expires", static_cast<double>(expiresAt));
+    sessionEntry.insert("consumerKey", clientKey);
+    sessionEntry.insert("consumerSecret", clientSecret);
+    sessionList.insert(clientCredentialKey(), sessionEntry);
+
+    writePrivateStore(sessionStoreFile, sessionList);
+}
+
+void AgaveHandler::forgetSession()
+{
+    if (sessionStoreFile.isEmpty()) return;
+
+    QJsonObject sessionList = readPrivateStore(sessionStoreFile);
+    if (!sessionList.contains(clientCredentialKey())) return;
+    sessionList.remove(clientCredentialKey());
+    writePrivateStore(sessionStoreFile, sessionList);
+}
+
+bool AgaveHandler::privateStorePathIsValid(QString filePath)
+{
+    //Empty turns the store off
+    if (filePath.isEmpty()) return true;
+
+    //An empty base directory would otherwise put the file at the top of the file system
+    QFileInfo storeFileInfo(filePath);
+    return (!storeFileInfo.isRelative() && (storeFileInfo.absolutePath() != QDir::rootPath()));
+}
+
+QJsonObject AgaveHandler::readPrivateStore(QString filePath)
+{
+    QFile storeFile(filePath);
+    if (!storeFile.open(QIODevice::ReadOnly)) return QJsonObject();
+    return QJsonDocument::fromJson(storeFile.readAll()).object();
+}
+
+bool AgaveHandler::writePrivateStore(QString filePath, QJsonObject storeData)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    //These files hold secrets, so only the user may read them
+    QSaveFile storeFile(filePath);
+    if (!storeFile.open(QIODevice::WriteOnly)) return false;
+    storeFile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    storeFile.write(QJsonDocument(storeData).toJson(QJsonDocument::Compact));
+    return storeFile.commit();
+}
+
+bool AgaveHandler::fallBackToClientRegistration(AgaveTaskReply * agaveReply, QString oauthError)
+{
+    if (!usingCachedClient || (agaveReply->getTaskGuide()->getTaskKind() != AgaveTaskKind::AUTH_STEP3)) return false;
+    if (currentState != RemoteDataInterfaceState::AUTH_TRY) return false;
+    //A wrong password or a network error says nothing about the saved client, which is kept
+    if (oauthError != "invalid_client") return false;
+
+    //The saved client may have been deleted elsewhere, so the full chain makes a new one
+    qCDebug(remoteInterface, "Saved client credentials refused, registering client again.");
+    usingCachedClient = false;
+    forgetClientCredentials();
+    clientKey = "";
+    clientSecret = "";
+    clientEncoded = "";
+
+    QMap<QString, QByteArray> varList;
+    performAgaveQuery("authStep1", varList, qobject_cast<AgaveTaskReply *>(agaveReply->parent()));
+    return true;
+}
+
 void AgaveHandler::forwardReplyToParent(AgaveTaskReply * agaveReply, RequestState replyState)
 {
     AgaveTaskReply * parentReply = qobject_cast<AgaveTaskReply *>(agaveReply->parent());
@@ -930,9 +1741,29 @@ void AgaveHandler::forwardReplyToParent(AgaveTaskReply * agaveReply, RequestStat
         qCDebug(remoteInterface, "ERROR: Invalid parent for forwarding task.");
         return;
     }
+
+    if ((replyState != RequestState::GOOD) && (parentReply->getTaskGuide()->getTaskKind() == AgaveTaskKind::FULL_AUTH))
+    {
+        releaseAuthWaiters(replyState);
+    }
     parentReply->rawNoDataNoHttpTaskComplete(replyState);
 }
 
+QString AgaveHandler::requestKey(AgaveTaskGuide * taskGuide, QMap<QString, QByteArray> * varList)
+{
+    QString ret = taskGuide->getTaskID();
+    ret.append(":").append(taskGuide->getArgAndURLsuffix(varList));
+    return ret;
+}
+
+bool AgaveHandler::requestIsReadOnly(AgaveTaskGuide * taskGuide)
+{
+    AgaveRequestType theType = taskGuide->getRequestType();
+    return ((theType == AgaveRequestType::AGAVE_GET) || (theType == AgaveRequestType::AGAVE_DOWNLOAD)
+            || (theType == AgaveRequestType::AGAVE_PIPE_DOWNLOAD) || (theType == AgaveRequestType::AGAVE_SINK_DOWNLOAD)
+            || (theType == AgaveRequestType::AGAVE_NONE) || taskGuide->isInternal());
+}
+
 bool AgaveHandler::noPendingHttpRequests()
 {
     return (pendingRequestCount == 0);
@@ -947,13 +1778,19 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply *agaveReply, RequestState t
         return;
     }
 
-    if (agaveReply->getTaskGuide()->getTaskID() == "authRevoke")
+    if (agaveReply->getTaskGuide()->getTaskKind() == AgaveTaskKind::AUTH_REVOKE)
     {
         qCDebug(remoteInterface, "Auth revoke procedure complete");
         changeAuthState(RemoteDataInterfaceState::DISCONNECTED);
         return;
     }
 
+    if (agaveReply->getTaskGuide()->getTaskKind() == AgaveTaskKind::AUTH_REFRESH)
+    {
+        failTokenRefresh(agaveReply, taskState);
+        return;
+    }
+
     if (taskState == RequestState::GOOD)
     {
         qCDebug(remoteInterface, "ERROR: Internal handler with explicit RequestState should never be GOOD");
@@ -961,9 +1798,9 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply *agaveReply, RequestState t
         return;
     }
 
-    QString taskID = agaveReply->getTaskGuide()->getTaskID();
+    AgaveTaskKind taskKind = agaveReply->getTaskGuide()->getTaskKind();
 
-    if ((taskID == "authStep1") || (taskID == "authStep1a") || (taskID == "authStep2") || (taskID == "authStep3"))
+    if ((taskKind == AgaveTaskKind::AUTH_STEP1) || (taskKind == AgaveTaskKind::AUTH_STEP1A) || (taskKind == AgaveTaskKind::AUTH_STEP2) || (taskKind == AgaveTaskKind::AUTH_STEP3))
     {
         if (currentState == RemoteDataInterfaceState::CANCEL_AUTH)
         {
@@ -985,7 +1822,7 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
         return;
     }
 
-    if (agaveReply->getTaskGuide()->getTaskID() == "authRevoke")
+    if (agaveReply->getTaskGuide()->getTaskKind() == AgaveTaskKind::AUTH_REVOKE)
     {
         qCDebug(remoteInterface, "Auth revoke procedure complete");
         changeAuthState(RemoteDataInterfaceState::DISCONNECTED);
@@ -996,9 +1833,16 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
 
     QJsonParseError parseError;
     QJsonDocument parseHandler = QJsonDocument::fromJson(replyText, &parseError);
+    QString oauthError = oauthErrorCode(rawReply, &parseHandler);
 
     if (parseHandler.isNull())
     {
+        if (agaveReply->getTaskGuide()->getTaskKind() == AgaveTaskKind::AUTH_REFRESH)
+        {
+            failTokenRefresh(agaveReply, RequestState::JSON_PARSE_ERROR);
+            return;
+        }
+        if (fallBackToClientRegistration(agaveReply, oauthError)) return;
         forwardReplyToParent(agaveReply, RequestState::JSON_PARSE_ERROR);
         return;
     }
@@ -1007,11 +1851,49 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
 
     RequestState prelimResult = AgaveTaskReply::standardSuccessFailCheck(agaveReply->getTaskGuide(), &parseHandler);
 
-    QString taskID = agaveReply->getTaskGuide()->getTaskID();
+    AgaveTaskKind taskKind = agaveReply->getTaskGuide()->getTaskKind();
+
+    //A background token refresh has no parent reply, its result goes to the requests waiting on it
+    //When resuming a saved session, the parent is the login reply
+    if (taskKind == AgaveTaskKind::AUTH_REFRESH)
+    {
+        bool resumingSession = (qobject_cast<AgaveTaskReply *>(agaveReply->parent()) != nullptr);
+        QByteArray newToken = AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "access_token").toString().toLatin1();
+        QByteArray newRefreshToken = AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "refresh_token").toString().toLatin1();
+
+        RemoteDataInterfaceState expectedState = RemoteDataInterfaceState::CONNECTED;
+        if (resumingSession) expectedState = RemoteDataInterfaceState::AUTH_TRY;
+
+        if ((prelimResult != RequestState::GOOD) || newToken.isEmpty() || newRefreshToken.isEmpty()
+                || (currentState != expectedState))
+        {
+            failTokenRefresh(agaveReply, RequestState::REMOTE_SERVER_ERROR, (oauthError == "invalid_grant"));
+            return;
+        }
+
+        token = newToken;
+        refreshToken = newRefreshToken;
+        tokenHeader = (QString("Bearer ").append(token)).toLatin1();
+        qint64 expiresIn = AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "expires_in").toVariant().toLongLong();
+        scheduleTokenRefresh(expiresIn);
+        storeSession(expiresIn);
+
+        qCDebug(remoteInterface, "Access token refreshed.");
+        if (resumingSession)
+        {
+            changeAuthState(RemoteDataInterfaceState::CONNECTED);
+            forwardReplyToParent(agaveReply, RequestState::GOOD);
+            return;
+        }
+        finishTokenRefresh(RequestState::GOOD);
+        return;
+    }
 
     if ((prelimResult != RequestState::GOOD) && (prelimResult != RequestState::EXPLICIT_ERROR))
     {
-        if ((taskID == "authStep1") || (taskID == "authStep1a") || (taskID == "authStep2") || (taskID == "authStep3"))
+        if (fallBackToClientRegistration(agaveReply, oauthError)) return;
+
+        if ((taskKind == AgaveTaskKind::AUTH_STEP1) || (taskKind == AgaveTaskKind::AUTH_STEP1A) || (taskKind == AgaveTaskKind::AUTH_STEP2) || (taskKind == AgaveTaskKind::AUTH_STEP3))
         {
             changeAuthState(RemoteDataInterfaceState::READY_TO_AUTH);
         }
@@ -1019,7 +1901,7 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
         return;
     }
 
-    if (taskID == "authStep1")
+    if (taskKind == AgaveTaskKind::AUTH_STEP1)
     {
         if (currentState == RemoteDataInterfaceState::CANCEL_AUTH)
         {
@@ -1051,7 +1933,7 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
             }
         }
     }
-    else if (taskID == "authStep1a")
+    else if (taskKind == AgaveTaskKind::AUTH_STEP1A)
     {
         if (prelimResult == RequestState::GOOD)
         {
@@ -1064,7 +1946,7 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
             forwardReplyToParent(agaveReply, prelimResult);
         }
     }
-    else if (taskID == "authStep2")
+    else if (taskKind == AgaveTaskKind::AUTH_STEP2)
     {
         if (prelimResult == RequestState::GOOD)
         {
@@ -1078,15 +1960,11 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
                 return;
             }
 
-            clientEncoded = "Basic ";
-            QByteArray rawAuth(clientKey.toLatin1());
-            rawAuth.append(":");
-            rawAuth.append(clientSecret);
-            clientEncoded.append(rawAuth.toBase64());
+            setClientEncoded();
 
             QMap<QString, QByteArray> varList;
-            varList.insert("authUname", authUname.toLatin1());
-            varList.insert("authPass", authPass.toLatin1());
+            varList.insert("authUname", authUname.toUtf8());
+            varList.insert("authPass", authPass.toUtf8());
 
             performAgaveQuery("authStep3", varList, qobject_cast<AgaveTaskReply *>(agaveReply->parent()));
         }
@@ -1096,7 +1974,7 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
             forwardReplyToParent(agaveReply, prelimResult);
         }
     }
-    else if (taskID == "authStep3")
+    else if (taskKind == AgaveTaskKind::AUTH_STEP3)
     {
         if (prelimResult == RequestState::GOOD)
         {
@@ -1111,6 +1989,12 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
             else
             {
                 tokenHeader = (QString("Bearer ").append(token)).toLatin1();
+                scheduleTokenRefresh(AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "expires_in").toVariant().toLongLong());
+                if (!usingCachedClient)
+                {
+                    storeClientCredentials();
+                }
+                storeSession(AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "expires_in").toVariant().toLongLong());
 
                 changeAuthState(RemoteDataInterfaceState::CONNECTED);
                 forwardReplyToParent(agaveReply, RequestState::GOOD);
@@ -1119,30 +2003,11 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
         }
         else
         {
+            if (fallBackToClientRegistration(agaveReply, oauthError)) return;
             changeAuthState(RemoteDataInterfaceState::READY_TO_AUTH);
             forwardReplyToParent(agaveReply, prelimResult);
         }
     }
-    else if (taskID == "authRefresh")
-    {
-        qCDebug(remoteInterface, "Auth refresh occurred without being implemented.");
-        forwardReplyToParent(agaveReply, RequestState::NOT_IMPLEMENTED);
-
-        /*
-        if (prelimResult == RequestState::GOOD)
-        {
-            token = AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "access_token").toString().toLatin1();
-            refreshToken = AgaveTaskReply::retriveMainAgaveJSON(&parseHandler, "refresh_token").toString().toLatin1();
-
-            if (token.isEmpty() || refreshToken.isEmpty())
-            {
-                emit sendFatalErrorMessage("Token refresh failure.");
-                return;
-            }
-            //TODO: Will need more info here based on when, how and where refreshes are requested
-        }
-        */
-    }
     else
     {
         qCDebug(remoteInterface, "Non-existant internal request requested.");
@@ -1150,13 +2015,21 @@ void AgaveHandler::handleInternalTask(AgaveTaskReply * agaveReply, QNetworkReply
     }
 }
 
+QString AgaveHandler::oauthErrorCode(QNetworkReply * rawReply, QJsonDocument * parsedDoc)
+{
+    //The token endpoint names why it refused a request, such as invalid_grant or invalid_client
+    int statusCode = rawReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if ((statusCode != 400) && (statusCode != 401)) return QString();
+    return parsedDoc->object().value("error").toString();
+}
+
 AgaveTaskReply * AgaveHandler::performAgaveQuery(QString queryName)
 {
     QMap<QString, QByteArray> taskVars;
     return performAgaveQuery(queryName, taskVars);
 }
 
-AgaveTaskReply * AgaveHandler::performAgaveQuery(QString queryName, QMap<QString, QByteArray> varList, AgaveTaskReply * parentReq)
+AgaveTaskReply * AgaveHandler::performAgaveQuery(QString queryName, QMap<QString, QByteArray> varList, AgaveTaskReply * parentReq, QIODevice * dataDevice)
 {
     //The network availabilty flag seems innacurate cross-platform
     /*
@@ -1176,32 +2049,187 @@ AgaveTaskReply * AgaveHandler::performAgaveQuery(QString queryName, QMap<QString
 
     AgaveTaskGuide * taskGuide = retriveTaskGuide(queryName);
 
+    bool holdForLogin = false;
     if ((currentState != RemoteDataInterfaceState::CONNECTED) &&
             (taskGuide->getHeaderType() == AuthHeaderType::TOKEN))
     {
-        qCDebug(remoteInterface, "Rejecting request prior to connection established.");
-        return createDirectReply(taskGuide, RequestState::INVALID_STATE, parentReq);
+        if (queueDuringAuth && (currentState == RemoteDataInterfaceState::AUTH_TRY))
+        {
+            holdForLogin = true;
+        }
+        else
+        {
+            qCDebug(remoteInterface, "Rejecting request prior to connection established.");
+            return createDirectReply(taskGuide, RequestState::INVALID_STATE, parentReq);
+        }
+    }
+
+    QObject * parentObj = qobject_cast<QObject *>(this);
+    if (parentReq != nullptr) parentObj = qobject_cast<QObject *>(parentReq);
+
+    AgaveTaskReply * ret = new AgaveTaskReply(taskGuide, this, parentObj);
+
+    for (auto itr = varList.cbegin(); itr != varList.cend(); itr++)
+    {
+        ret->getTaskParamList()->insert(itr.key(), *itr);
+    }
+
+    if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD)
+    {
+        ret->setDownloadSink(dataDevice);
+    }
+    else
+    {
+        ret->setUploadSource(dataDevice);
+    }
+
+    //Sent once the login in progress gives us a token
+    if (holdForLogin)
+    {
+        authWaitList.append(ret);
+        return ret;
     }
 
-    QNetworkReply * qReply = distillRequestData(taskGuide, &varList);
+    //Internal tasks, such as the login steps, are never held back
+    if (taskGuide->isInternal())
+    {
+        dispatchRequest(ret);
+        return ret;
+    }
+
+    requestScheduler->enqueueRequest(ret);
+    return ret;
+}
+
+QNetworkReply * AgaveHandler::dispatchRequest(AgaveTaskReply * theReply)
+{
+    AgaveTaskGuide * taskGuide = theReply->getTaskGuide();
+
+    //Cancelled while still in the queue
+    if (theReply->requestEnded) return nullptr;
+
+    //The interface may have changed state while the request was queued
+    if ((currentState == RemoteDataInterfaceState::CANCEL_AUTH) ||
+            (currentState == RemoteDataInterfaceState::DISCONNECTED) ||
+            (currentState == RemoteDataInterfaceState::DISCONNECTING))
+    {
+        if (taskGuide->getTaskKind() != AgaveTaskKind::AUTH_REVOKE)
+        {
+            qCDebug(remoteInterface, "Dropping queued request during shutdown.");
+            theReply->setDelayedDatalessReply(RequestState::INVALID_STATE);
+            return nullptr;
+        }
+    }
+
+    if ((currentState != RemoteDataInterfaceState::CONNECTED) &&
+            (taskGuide->getHeaderType() == AuthHeaderType::TOKEN))
+    {
+        theReply->setDelayedDatalessReply(RequestState::INVALID_STATE);
+        return nullptr;
+    }
+
+    QMap<QString, QByteArray> varList = *theReply->getTaskParamList();
+
+    if (!requestIsReadOnly(taskGuide))
+    {
+        //Anything cached may be out of date once remote data changes
+        responseCache.clear();
+    }
+
+    QString cacheKey;
+    if (taskGuide->isResponseCacheable())
+    {
+        cacheKey = requestKey(taskGuide, &varList);
+        if (!taskGuide->isCachedByETagOnly() && responseCache.hasFreshEntry(cacheKey))
+        {
+            qCDebug(remoteInterface, "Serving request from cache: %s", qPrintable(cacheKey));
+            theReply->setCachedReply(responseCache.getBody(cacheKey));
+            return nullptr;
+        }
+    }
+
+    //An identical GET already on the wire is joined, rather than sent again
+    QString coalesceKey;
+    if ((taskGuide->getRequestType() == AgaveRequestType::AGAVE_GET) && !taskGuide->isInternal())
+    {
+        coalesceKey = requestKey(taskGuide, &varList);
+
+        QNetworkReply * pendingReply = inFlightGets.value(coalesceKey);
+        if ((pendingReply != nullptr) && pendingReply->isRunning())
+        {
+            qCDebug(remoteInterface, "Joining in-flight request: %s", qPrintable(coalesceKey));
+            theReply->attachNetworkReply(pendingReply);
+            return nullptr;
+        }
+    }
+
+    QNetworkReply * qReply = distillRequestData(taskGuide, &varList, theReply->getUploadSource());
+    *theReply->getTaskParamList() = varList;
 
     if (qReply == nullptr)
     {
-        return createDirectReply(taskGuide, RequestState::INTERNAL_ERROR, parentReq);
+        theReply->setDelayedDatalessReply(RequestState::INTERNAL_ERROR);
+        return nullptr;
     }
     pendingRequestCount++;
 
-    QObject * parentObj = qobject_cast<QObject *>(this);
-    if (parentReq != nullptr) parentObj = qobject_cast<QObject *>(parentReq);
+    if (!coalesceKey.isEmpty())
+    {
+        qReply->setProperty("coalesceKey", coalesceKey);
+        inFlightGets.insert(coalesceKey, qReply);
+    }
+    if (!cacheKey.isEmpty())
+    {
+        qReply->setProperty("cacheKey", cacheKey);
+    }
 
-    AgaveTaskReply * ret = new AgaveTaskReply(taskGuide,qReply,this, parentObj);
+    armRequestTimers(qReply, taskGuide, theReply->getRequestPriority());
+    theReply->attachNetworkReply(qReply);
+    return qReply;
+}
 
-    for (auto itr = varList.cbegin(); itr != varList.cend(); itr++)
+void AgaveHandler::armRequestTimers(QNetworkReply * qReply, AgaveTaskGuide * theGuide, RequestPriority priorityClass)
+{
+    AgaveRequestType theType = theGuide->getRequestType();
+    bool isTransfer = ((theType == AgaveRequestType::AGAVE_UPLOAD) || (theType == AgaveRequestType::AGAVE_PIPE_UPLOAD)
+                       || (theType == AgaveRequestType::AGAVE_STREAM_UPLOAD) || (theType == AgaveRequestType::AGAVE_DOWNLOAD)
+                       || (theType == AgaveRequestType::AGAVE_PIPE_DOWNLOAD) || (theType == AgaveRequestType::AGAVE_SINK_DOWNLOAD));
+
+    //The timers are children of the reply, so they go away with it
+    //A transfer's length depends on its size, so whatever its class it is only stopped when it stalls
+    int deadline = requestDeadlines.at(static_cast<int>(priorityClass));
+    if (!isTransfer && (deadline > 0))
     {
-        ret->getTaskParamList()->insert(itr.key(), *itr);
+        QTimer * deadlineTimer = new QTimer(qReply);
+        deadlineTimer->setSingleShot(true);
+        QObject::connect(deadlineTimer, SIGNAL(timeout()), this, SLOT(requestTimerExpired()));
+        deadlineTimer->start(deadline);
     }
 
-    return ret;
+    if (isTransfer && (stallTimeout > 0))
+    {
+        //Each bit of progress, either way, restarts the stall timer
+        QTimer * stallTimer = new QTimer(qReply);
+        stallTimer->setSingleShot(true);
+        QObject::connect(stallTimer, SIGNAL(timeout()), this, SLOT(requestTimerExpired()));
+        QObject::connect(qReply, SIGNAL(downloadProgress(qint64,qint64)), stallTimer, SLOT(start()));
+        QObject::connect(qReply, SIGNAL(uploadProgress(qint64,qint64)), stallTimer, SLOT(start()));
+        stallTimer->start(stallTimeout);
+    }
+}
+
+void AgaveHandler::requestTimerExpired()
+{
+    QTimer * expiredTimer = qobject_cast<QTimer *>(sender());
+    if (expiredTimer == nullptr) return;
+    QNetworkReply * expiredReply = qobject_cast<QNetworkReply *>(expiredTimer->parent());
+    if ((expiredReply == nullptr) || !expiredReply->isRunning()) return;
+
+    qCDebug(remoteInterface, "Request timed out: %s", qPrintable(expiredReply->url().toString()));
+
+    //Every reply object sharing this request sees the flag, and reports TIMED_OUT
+    expiredReply->setProperty("timedOut", true);
+    expiredReply->abort();
 }
 
 AgaveTaskReply * AgaveHandler::createDirectReply(QString theTaskType, RequestState errorState, AgaveTaskReply * parentReq)
@@ -1216,7 +2244,7 @@ AgaveTaskReply * AgaveHandler::createDirectReply(AgaveTaskGuide * theTaskType, R
     return new AgaveTaskReply(theTaskType, errorState, this, parentObj);
 }
 
-QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMap<QString, QByteArray> * varList)
+QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMap<QString, QByteArray> * varList, QIODevice * dataDevice)
 {
     QByteArray * authHeader = nullptr;
     if (taskGuide->getHeaderType() == AuthHeaderType::CLIENT)
@@ -1245,13 +2273,20 @@ QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMa
     else if ((taskGuide->getRequestType() == AgaveRequestType::AGAVE_GET) || (taskGuide->getRequestType() == AgaveRequestType::AGAVE_DELETE))
     {
         qCDebug(remoteInterface, "URL Req: %s", qPrintable(taskGuide->getArgAndURLsuffix(varList)));
+
+        //With a cached copy on hand, the server need only say whether it changed
+        QMap<QByteArray, QByteArray> extraHeaders;
+        if (taskGuide->isResponseCacheable())
+        {
+            extraHeaders = responseCache.getValidatorHeaders(requestKey(taskGuide, varList), taskGuide->isCachedByETagOnly());
+        }
         return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList),
-                         authHeader);
+                         authHeader, "", nullptr, extraHeaders);
     }
     else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_UPLOAD)
     {
         //For agave upload, instead of post params, we have the full local file name
-        QString fullFileName = QString::fromLatin1(varList->value("localFileName"));
+        QString fullFileName = QString::fromUtf8(varList->value("localFileName"));
         QFile * fileHandle = new QFile(fullFileName);
         if (!fileHandle->open(QIODevice::ReadOnly))
         {
@@ -1261,26 +2296,39 @@ QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMa
         qCDebug(remoteInterface, "URL Req: %s", qPrintable(taskGuide->getArgAndURLsuffix(varList)));
 
         return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList),
-                         authHeader, fullFileName.toLatin1(), fileHandle);
+                         authHeader, fullFileName.toUtf8(), fileHandle);
     }
     else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_UPLOAD)
     {
         qCDebug(remoteInterface, "New File Name: %s\n", qPrintable(varList->value("newFileName")));
 
+        //The payload is shared with the caller's buffer rather than copied,
+        //and taken out of the var list so it is not held by the task reply as well
         QBuffer * pipedData = new QBuffer();
-        pipedData->open(QBuffer::ReadWrite);
-        pipedData->write(varList->value("fileData"));
-        pipedData->seek(0);
+        pipedData->setData(varList->take("fileData"));
+        pipedData->open(QBuffer::ReadOnly);
 
         qCDebug(remoteInterface, "URL Req: %s", qPrintable(taskGuide->getArgAndURLsuffix(varList)));
 
         return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList),
                          authHeader, varList->value("newFileName"), pipedData);
     }
+    else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_STREAM_UPLOAD)
+    {
+        if (dataDevice == nullptr) return nullptr;
+
+        AgaveStreamUpload * streamBody = new AgaveStreamUpload(dataDevice, QString::fromUtf8(varList->value("newFileName")),
+                                                               varList->value("expectedSize").toLongLong());
+
+        qCDebug(remoteInterface, "URL Req: %s", qPrintable(taskGuide->getArgAndURLsuffix(varList)));
+
+        return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList),
+                         authHeader, "", streamBody);
+    }
     else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD)
     {
         //For agave download, instead of post params, we have the full local file name
-        QString fullFileName = varList->value("localDest");
+        QString fullFileName = QString::fromUtf8(varList->value("localDest"));
         QFile * fileHandle = new QFile(fullFileName);
         if (fileHandle->open(QIODevice::ReadOnly))
         {
@@ -1292,12 +2340,34 @@ QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMa
         fileHandle->deleteLater();
         qCDebug(remoteInterface, "URL Req: %s", qPrintable(taskGuide->getArgAndURLsuffix(varList)));
 
+        //A partial file left by an interrupted attempt lets us ask for only the missing bytes
+        QMap<QByteArray, QByteArray> extraHeaders;
+        QByteArray lastModified;
+        qint64 remoteSize = -1;
+        varList->remove("resumeOffset");
+        varList->remove("resumeSize");
+        qint64 resumeOffset = AgaveDownloadTarget::findResumeOffset(fullFileName, varList->value("remoteName"), &lastModified, &remoteSize);
+        if (resumeOffset > 0)
+        {
+            qCDebug(remoteInterface, "Resuming download of %s at byte %lld", qPrintable(fullFileName), resumeOffset);
+            varList->insert("resumeOffset", QByteArray::number(resumeOffset));
+            varList->insert("resumeSize", QByteArray::number(remoteSize));
+            extraHeaders.insert("Range", QByteArray("bytes=").append(QByteArray::number(resumeOffset)).append("-"));
+            //If the remote file has changed since, the server sends the whole file instead
+            extraHeaders.insert("If-Range", lastModified);
+        }
+
         return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList),
-                         authHeader);
+                         authHeader, "", nullptr, extraHeaders);
     }
-    else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD)
+    else if ((taskGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD) || (taskGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD))
     {
-        return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList), authHeader);
+        QMap<QByteArray, QByteArray> extraHeaders;
+        if (varList->contains("rangeStart"))
+        {
+            extraHeaders.insert("Range", QByteArray("bytes=").append(varList->value("rangeStart")).append("-").append(varList->value("rangeEnd")));
+        }
+        return finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(varList), authHeader, "", nullptr, extraHeaders);
     }
     else if (taskGuide->getRequestType() == AgaveRequestType::AGAVE_JSON_POST)
     {
@@ -1311,7 +2381,35 @@ QNetworkReply * AgaveHandler::distillRequestData(AgaveTaskGuide * taskGuide, QMa
     }
 }
 
-QNetworkReply * AgaveHandler::finalizeAgaveRequest(AgaveTaskGuide * theGuide, QString urlAppend, QByteArray * authHeader, QByteArray postData, QIODevice * fileHandle)
+QNetworkReply * AgaveHandler::performRangeRequest(QString remoteName, qint64 rangeStart, qint64 rangeEnd)
+{
+    if (currentState != RemoteDataInterfaceState::CONNECTED) return nullptr;
+
+    AgaveTaskGuide * taskGuide = retriveTaskGuide("fileDownload");
+    if (taskGuide == nullptr) return nullptr;
+
+    QMap<QString, QByteArray> varList;
+    varList.insert("remoteName", remoteName.toUtf8());
+
+    QByteArray rangeHeader("bytes=");
+    rangeHeader.append(QByteArray::number(rangeStart)).append("-");
+    if (rangeEnd >= 0) rangeHeader.append(QByteArray::number(rangeEnd));
+
+    QMap<QByteArray, QByteArray> extraHeaders;
+    extraHeaders.insert("Range", rangeHeader);
+
+    //Over HTTP/2 every segment would share one connection, which is what segmenting is meant to avoid
+    QNetworkReply * qReply = finalizeAgaveRequest(taskGuide, taskGuide->getArgAndURLsuffix(&varList),
+                                                  &tokenHeader, "", nullptr, extraHeaders, false);
+    if (qReply == nullptr) return nullptr;
+
+    pendingRequestCount++;
+    armRequestTimers(qReply, taskGuide, RequestPriority::BULK);
+    return qReply;
+}
+
+QNetworkReply * AgaveHandler::finalizeAgaveRequest(AgaveTaskGuide * theGuide, QString urlAppend, QByteArray * authHeader, QByteArray postData, QIODevice * fileHandle,
+                                                   QMap<QByteArray, QByteArray> extraHeaders, bool allowHttp2)
 {
     QNetworkReply * clientReply = nullptr;
 
@@ -1338,12 +2436,18 @@ QNetworkReply * AgaveHandler::finalizeAgaveRequest(AgaveTaskGuide * theGuide, QS
         clientRequest->setRawHeader(QByteArray("Authorization"), *authHeader);
     }
 
+    for (auto itr = extraHeaders.cbegin(); itr != extraHeaders.cend(); itr++)
+    {
+        clientRequest->setRawHeader(itr.key(), *itr);
+    }
+
     clientRequest->setSslConfiguration(SSLoptions);
+    clientRequest->setAttribute(http2AllowedAttribute, http2Enabled && allowHttp2);
 
     qCDebug(remoteInterface, "%s", qPrintable(clientRequest->url().url()));
 
     if ((theGuide->getRequestType() == AgaveRequestType::AGAVE_GET) || (theGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD)
-            || (theGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD))
+            || (theGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD) || (theGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD))
     {
         clientReply = networkHandle->get(*clientRequest);
     }
@@ -1366,8 +2470,9 @@ QNetworkReply * AgaveHandler::finalizeAgaveRequest(AgaveTaskGuide * theGuide, QS
         QHttpPart filePart;
         filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-strem"));
         QString tempString = "form-data; name=\"fileToUpload\"; filename=\"%1\"";
-        tempString = tempString.arg(QString(postData));
-        filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant(tempString));
+        tempString = tempString.arg(QString::fromUtf8(postData));
+        //Set raw, as the typed header would be narrowed to Latin-1
+        filePart.setRawHeader("Content-Disposition", tempString.toUtf8());
 
         filePart.setBodyDevice(fileHandle);
         //Following line is to insure deletion of the file handle later, when the parent is deleted
@@ -1380,12 +2485,29 @@ QNetworkReply * AgaveHandler::finalizeAgaveRequest(AgaveTaskGuide * theGuide, QS
         //Following line insures Mulipart object deleted when the network reply is
         fileUpload->setParent(clientReply);
     }
+    else if (theGuide->getRequestType() == AgaveRequestType::AGAVE_STREAM_UPLOAD)
+    {
+        AgaveStreamUpload * streamBody = qobject_cast<AgaveStreamUpload *>(fileHandle);
+        clientRequest->setHeader(QNetworkRequest::ContentTypeHeader, QVariant(streamBody->getContentType()));
+        clientRequest->setHeader(QNetworkRequest::ContentLengthHeader, QVariant(streamBody->getContentLength()));
+        //With the length known up front, the body is sent as it is read instead of being buffered first
+        clientRequest->setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+
+        clientReply = networkHandle->post(*clientRequest, streamBody);
+        streamBody->setParent(clientReply);
+    }
     else if (theGuide->getRequestType() == AgaveRequestType::AGAVE_JSON_POST)
     {
         clientRequest->setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/json"));
         clientReply = networkHandle->post(*clientRequest, postData);
     }
 
+    if ((theGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD) || (theGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD))
+    {
+        //File downloads are streamed out as they arrive, so the reply never needs to hold more than this
+        clientReply->setReadBufferSize(downloadBufferSize);
+    }
+
     QObject::connect(clientReply, SIGNAL(finished()), this, SLOT(finishedOneTask()), Qt::QueuedConnection);
 
     return clientReply;
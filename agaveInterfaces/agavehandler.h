@@ -37,12 +37,23 @@
 #define AGAVEHANDLER_H
 
 #include "remotedatainterface.h"
+#include "agaveresponsecache.h"
+#include "agaveretrypolicy.h"
 
 #include <QObject>
 #include <QNetworkReply>
 #include <QHttpMultiPart>
 #include <QFile>
 #include <QBuffer>
+#include <QHash>
+#include <QPointer>
+#include <QVector>
+#include <QTimer>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#include <functional>
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -52,16 +63,20 @@
  *  This enum describes the various ways an http Agave request can be sent.
  */
 
-enum class AgaveRequestType {AGAVE_GET, AGAVE_POST, AGAVE_DELETE, AGAVE_UPLOAD, AGAVE_PIPE_UPLOAD, AGAVE_PIPE_DOWNLOAD, AGAVE_DOWNLOAD, AGAVE_PUT, AGAVE_NONE, AGAVE_APP, AGAVE_JSON_POST};
+enum class AgaveRequestType {AGAVE_GET, AGAVE_POST, AGAVE_DELETE, AGAVE_UPLOAD, AGAVE_PIPE_UPLOAD, AGAVE_STREAM_UPLOAD, AGAVE_PIPE_DOWNLOAD, AGAVE_SINK_DOWNLOAD, AGAVE_DOWNLOAD, AGAVE_PUT, AGAVE_NONE, AGAVE_APP, AGAVE_JSON_POST};
 
 class AgaveTaskGuide;
 class AgaveTaskReply;
+class AgaveRequestScheduler;
+class AgaveReplyProxy;
 
 /*! \brief The AgaveHandler is a class for communicating with an Agave server over an https connection.
  *
  *  Each AgaveHandler is one use, from initialization, to login, through multiple remote requests, to logout. If an application wishes to re-login, a new AgaveHandler object should be created.
  *
- *  First, the setAgaveConnectionParams meshod should be invoked, to define some basic Agave parameters, such as the remote tenant name. Then, the performAuth method should be invoked until a successful reply is given. After that, the various remote tasks can be performed. When finished, the closeAllConnections method will logout of the remote Agave server.
+ *  First, the setAgaveConnectionParams meshod should be invoked, to define some basic Agave parameters, such as the remote tenant name. Then, the performAuth method should be invoked until a successful reply is given, or resumeSession, if an earlier process saved its session. After that, the various remote tasks can be performed. When finished, the closeAllConnections method will logout of the remote Agave server.
+ *
+ *  The public methods may be called from any thread, without waiting on the AgaveHandler's own thread. From another thread, a request gives an AgaveReplyProxy at once, and is made in the AgaveHandler's thread, in the order given. Settings are likewise applied in order, and getInterfaceState and getUserName read a copy kept up to date by the AgaveHandler.
  *
  */
 
@@ -70,6 +85,8 @@ class AgaveHandler : public RemoteDataInterface
     Q_OBJECT
 
     friend class AgaveTaskReply;
+    friend class AgaveSegmentedDownload;
+    friend class AgaveRequestScheduler;
 
 public:
     explicit AgaveHandler(QNetworkAccessManager * netAccessManager, QObject * parent = nullptr);
@@ -95,8 +112,11 @@ public slots:
 
     virtual RemoteDataReply * uploadFile(QString location, QString localFileName);
     virtual RemoteDataReply * uploadBuffer(QString location, QByteArray fileData, QString newFileName);
+    virtual RemoteDataReply * uploadStream(QString location, QIODevice * dataSource, QString newFileName, qint64 expectedSize);
     virtual RemoteDataReply * downloadFile(QString localDest, QString remoteName);
     virtual RemoteDataReply * downloadBuffer(QString remoteName);
+    virtual RemoteDataReply * downloadBufferRange(QString remoteName, qint64 offset, qint64 length);
+    virtual RemoteDataReply * downloadToDevice(QString remoteName, QIODevice * sink);
 
     virtual RemoteDataReply * runRemoteJob(QString jobName, ParamMap jobParameters, QString remoteWorkingDir, QString indivJobName = "", QString archivePath = "");
 
@@ -119,6 +139,50 @@ public slots:
 
     void setAgaveConnectionParams(QString tenant, QString clientId, QString storage);
 
+    //In place of performAuth, picks up the tokens saved by an earlier process (see setSessionStore)
+    //Gives NOT_READY through haveAuthReply if there is no saved session for this user
+    RemoteDataReply * resumeSession(QString uname);
+
+    //Limit on requests of one priority class sent at once, others wait their turn
+    //Keep background plus bulk below 6, the per-host connection limit, or interactive requests wait behind them
+    void setMaxRequestsInFlight(RequestPriority priorityClass, int maxCount);
+
+    //How long a listing without ETag or Last-Modified is reused without asking the server, 0 to always ask
+    void setResponseCacheTTL(int msecs);
+
+    //Attempts per request for transient failures, and retries allowed per minute across all requests
+    void setRetryLimits(int maxAttempts, int maxRetriesPerMinute);
+    //Wait before the first retry, doubled for each one after up to maxMsecs, unless the server gives Retry-After
+    void setRetryBackoff(int baseMsecs, int maxMsecs);
+
+    //Longest time a request of a priority class may take in total, 0 for no limit
+    //Uploads and downloads are exempt whatever their class, and only limited by the stall timeout
+    void setRequestDeadline(RequestPriority priorityClass, int msecs);
+    //Longest time an upload or download may go without moving any bytes, 0 for no limit
+    void setStallTimeout(int msecs);
+
+    //HTTP/2 is used when the server supports it, unless turned off here
+    void setHttp2Enabled(bool enabled);
+
+    //Where TLS session tickets are kept between runs, keyed by tenant, empty (the default) to not keep them
+    //Must be an absolute path, not at the top of the file system
+    void setSessionTicketFile(QString filePath);
+
+    //Where the OAuth client made at login is kept for later logins, empty (the default) to make one each time
+    void setClientCredentialStore(QString filePath);
+
+    //Where the tokens of a successful login are kept for resumeSession, empty (the default) to not keep them
+    void setSessionStore(QString filePath);
+
+    //If set, requests made while login is in progress wait for it, rather than failing with INVALID_STATE
+    //They are sent as soon as login succeeds, or given the login error if it fails
+    void setQueueRequestsDuringAuth(bool enabled);
+
+    //Number of concurrent byte ranges used by downloadFile, 1 (the default) for a single stream
+    //Segments share the BULK in-flight limit (see setMaxRequestsInFlight) with all other bulk transfers,
+    //so no more than that many run at once; the rest wait for a free slot
+    void setDownloadSegmentCount(int segmentCount);
+
     RemoteDataReply * runAgaveJob(QJsonDocument rawJobJSON);
 
 protected:
@@ -127,19 +191,62 @@ protected:
 
 private slots:
     void finishedOneTask();
+    void requestTimerExpired();
+    void refreshAccessToken();
+    void writeSessionTicket();
+    void processSubmissions();
+    void deliverDeferredReplies();
 
 private:
     AgaveTaskReply * performAgaveQuery(QString queryName);
-    AgaveTaskReply * performAgaveQuery(QString queryName, QMap<QString, QByteArray> varList, AgaveTaskReply *parentReq = nullptr);
+    AgaveTaskReply * performAgaveQuery(QString queryName, QMap<QString, QByteArray> varList, AgaveTaskReply *parentReq = nullptr, QIODevice * dataDevice = nullptr);
+    QNetworkReply * dispatchRequest(AgaveTaskReply * theReply);
     AgaveTaskReply * createDirectReply(AgaveTaskGuide * theTaskType, RequestState errorState, AgaveTaskReply *parentReq = nullptr);
     AgaveTaskReply * createDirectReply(QString theTaskType, RequestState errorState, AgaveTaskReply *parentReq = nullptr);
 
-    QNetworkReply * distillRequestData(AgaveTaskGuide * theGuide, QMap<QString, QByteArray> * varList);
-    QNetworkReply * finalizeAgaveRequest(AgaveTaskGuide * theGuide, QString urlAppend, QByteArray * authHeader = nullptr, QByteArray postData = "", QIODevice * fileHandle = nullptr);
+    QNetworkReply * distillRequestData(AgaveTaskGuide * theGuide, QMap<QString, QByteArray> * varList, QIODevice * dataDevice = nullptr);
+    QNetworkReply * finalizeAgaveRequest(AgaveTaskGuide * theGuide, QString urlAppend, QByteArray * authHeader = nullptr, QByteArray postData = "", QIODevice * fileHandle = nullptr,
+                                         QMap<QByteArray, QByteArray> extraHeaders = QMap<QByteArray, QByteArray>(), bool allowHttp2 = true);
+    QNetworkReply * performRangeRequest(QString remoteName, qint64 rangeStart, qint64 rangeEnd);
+
+    void armRequestTimers(QNetworkReply * qReply, AgaveTaskGuide * theGuide, RequestPriority priorityClass);
+
+    void scheduleTokenRefresh(qint64 expiresIn);
+    void retryTokenRefresh();
+    void failTokenRefresh(AgaveTaskReply * agaveReply, RequestState failState, bool grantRefused = false);
+    static QString oauthErrorCode(QNetworkReply * rawReply, QJsonDocument * parsedDoc);
+    void replayAfterTokenRefresh(AgaveTaskReply * theReply);
+    //For requests sent outside of an AgaveTaskReply, resumeCall is given the result of the next refresh
+    void waitForTokenRefresh(QObject * waiter, std::function<void(RequestState)> resumeCall);
+    void finishTokenRefresh(RequestState refreshState);
+    bool acceptingRequests();
+    void publishStateSnapshot();
+    void deferReply(AgaveTaskReply * theReply);
+    RemoteDataReply * submitRequest(std::function<RemoteDataReply *()> requestCall);
+    void releaseAuthWaiters(RequestState loginState);
+
+    QString clientCredentialKey();
+    bool loadClientCredentials();
+    void storeClientCredentials();
+    void forgetClientCredentials();
+    bool fallBackToClientRegistration(AgaveTaskReply * agaveReply, QString oauthError);
+    void setClientEncoded();
+
+    void storeSession(qint64 expiresIn);
+    void forgetSession();
+
+    static bool privateStorePathIsValid(QString filePath);
+    static QJsonObject readPrivateStore(QString filePath);
+    static bool writePrivateStore(QString filePath, QJsonObject storeData);
+
+    void loadSessionTicket();
+    void storeSessionTicket(QByteArray newTicket, int lifeTimeHint);
 
     void forwardReplyToParent(AgaveTaskReply * agaveReply, RequestState replyState);
 
     bool noPendingHttpRequests();
+    static QString requestKey(AgaveTaskGuide * taskGuide, QMap<QString, QByteArray> * varList);
+    static bool requestIsReadOnly(AgaveTaskGuide * taskGuide);
     void changeAuthState(RemoteDataInterfaceState newState);
 
     void setupTaskGuideList();
@@ -149,6 +256,7 @@ private:
     static bool remotePathStringIsValid(QString toCheck);
 
     QNetworkAccessManager * networkHandle;
+    AgaveRequestScheduler * requestScheduler;
     QSslConfiguration SSLoptions;
 
     QString tenantURL;
@@ -161,17 +269,75 @@ private:
     QByteArray tokenHeader;
     QByteArray refreshToken;
 
+    QTimer * tokenRefreshTimer;
+    bool tokenRefreshPending = false;
+    //Seconds since epoch, 0 if the token did not say when it expires
+    qint64 tokenExpiresAt = 0;
+    int tokenRefreshFailures = 0;
+    const qint64 tokenRetryBaseDelay = 5000;
+    const qint64 tokenRetryMaxDelay = 300000;
+    QList<QPointer<AgaveTaskReply>> tokenWaitList;
+    struct TokenWaiter
+    {
+        QPointer<QObject> waiter;
+        std::function<void(RequestState)> resumeCall;
+    };
+    QList<TokenWaiter> rawTokenWaitList;
+
+    bool queueDuringAuth = false;
+    QList<QPointer<AgaveTaskReply>> authWaitList;
+
     QString authUname;
     QString authPass;
     QString clientKey;
     QString clientSecret;
 
     QMap<QString, AgaveTaskGuide*> validTaskList;
+    QHash<QString, QPointer<QNetworkReply>> inFlightGets;
+    AgaveResponseCache responseCache;
+    AgaveRetryPolicy retryPolicy;
 
     QString pwd = "";
 
+    const qint64 downloadBufferSize = 1048576;
+    const int maxDownloadSegments = 16;
+    int downloadSegmentCount = 1;
+
+    //Indexed by RequestPriority; transfers of any class are only limited by the stall timeout
+    QVector<int> requestDeadlines = {60000, 120000, 0};
+    int stallTimeout = 30000;
+
+    bool http2Enabled = true;
+    QString sessionTicketFile;
+    //New tickets are written at most once per ticketWriteDelay, the latest one winning
+    QTimer * ticketWriteTimer;
+    const int ticketWriteDelay = 10000;
+    QByteArray pendingTicket;
+    qint64 pendingTicketExpiry = 0;
+    QString credentialStoreFile;
+    QString sessionStoreFile;
+    bool usingCachedClient = false;
+
     int pendingRequestCount = 0;
     RemoteDataInterfaceState currentState = RemoteDataInterfaceState::INIT;
+
+    //Replies given without a network request, delivered together on the next event loop pass
+    QList<QPointer<AgaveTaskReply>> deferredReplies;
+    bool deferredDeliveryScheduled = false;
+
+    //Requests made from other threads, waiting for this one, guarded by submissionLock:
+    struct PendingSubmission
+    {
+        AgaveReplyProxy * proxyReply = nullptr;
+        std::function<RemoteDataReply *()> requestCall;
+    };
+    QMutex submissionLock;
+    QList<PendingSubmission> submissionQueue;
+
+    //Copies for other threads, written only by changeAuthState:
+    QAtomicInt stateSnapshot;
+    QAtomicPointer<QString> userNameSnapshot;
+    QList<QString *> userNameSnapshots;
 };
 
 #endif // AGAVEHANDLER_H
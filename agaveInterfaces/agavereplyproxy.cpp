@@ -0,0 +1,216 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agavereplyproxy.h"
+
+/*! \brief The AgaveReplySignalRelay takes each RemoteDataReply signal of the actual reply and gives it to the proxy, with its arguments.
+ *
+ *  As with QSignalSpy, the signals are connected to method indices past those of QObject, which are caught in qt_metacall.
+ *  haveDownloadSegmentStats, which only an AgaveTaskReply has, is relayed as well when the actual reply has it.
+ */
+
+class AgaveReplySignalRelay : public QObject
+{
+public:
+    AgaveReplySignalRelay(AgaveReplyProxy * theProxy, RemoteDataReply * actualReply) : QObject(theProxy)
+    {
+        myProxy = theProxy;
+        const QMetaObject * replyMeta = &RemoteDataReply::staticMetaObject;
+        for (int i = replyMeta->methodOffset(); i < replyMeta->methodCount(); i++)
+        {
+            if (replyMeta->method(i).methodType() != QMetaMethod::Signal) continue;
+            connectSignal(actualReply, i, replyMeta->method(i));
+        }
+
+        int statsIndex = actualReply->metaObject()->indexOfSignal("haveDownloadSegmentStats(int,qint64,qint64)");
+        if (statsIndex >= 0)
+        {
+            connectSignal(actualReply, statsIndex, QMetaMethod::fromSignal(&AgaveReplyProxy::haveDownloadSegmentStats));
+        }
+    }
+
+    virtual int qt_metacall(QMetaObject::Call call, int methodId, void ** args)
+    {
+        methodId = QObject::qt_metacall(call, methodId, args);
+        if (methodId < 0) return methodId;
+        if (call == QMetaObject::InvokeMetaMethod)
+        {
+            if (methodId < proxySignals.size())
+            {
+                myProxy->relaySignal(proxySignals.at(methodId), args);
+            }
+            methodId -= proxySignals.size();
+        }
+        return methodId;
+    }
+
+private:
+    void connectSignal(RemoteDataReply * actualReply, int signalIndex, QMetaMethod proxySignal)
+    {
+        QMetaObject::connect(actualReply, signalIndex, this, QObject::staticMetaObject.methodCount() + proxySignals.size(), Qt::DirectConnection);
+        proxySignals.append(proxySignal);
+    }
+
+    AgaveReplyProxy * myProxy;
+    QList<QMetaMethod> proxySignals;
+};
+
+AgaveReplyProxy::AgaveReplyProxy() : RemoteDataReply(nullptr) {}
+
+void AgaveReplyProxy::setAsUnconnectedReply()
+{
+    settingsLock.lock();
+    hasUnconnected = true;
+    settingsLock.unlock();
+    callerReady.storeRelease(1);
+    QMetaObject::invokeMethod(this, "deliverHeldSignals", Qt::QueuedConnection);
+    settingsChanged();
+}
+
+void AgaveReplyProxy::setRequestPriority(RequestPriority newPriority, QObject * client)
+{
+    settingsLock.lock();
+    hasPriority = true;
+    requestPriority = newPriority;
+    requestClient = client;
+    settingsLock.unlock();
+    settingsChanged();
+}
+
+void AgaveReplyProxy::cancel()
+{
+    settingsLock.lock();
+    hasCancel = true;
+    settingsLock.unlock();
+    settingsChanged();
+}
+
+void AgaveReplyProxy::attachRequest(RemoteDataReply * actualReply)
+{
+    requestAttached = true;
+    if (actualReply == nullptr)
+    {
+        qCDebug(remoteInterface, "ERROR: Submitted request gave no reply.");
+        this->deleteLater();
+        return;
+    }
+    myRequest = actualReply;
+
+    new AgaveReplySignalRelay(this, actualReply);
+    QObject::connect(actualReply, SIGNAL(destroyed()), this, SLOT(actualRequestDone()));
+
+    applyRequestSettings();
+}
+
+void AgaveReplyProxy::connectNotify(const QMetaMethod &signal)
+{
+    //Called in the caller's thread. Only the result signals show the caller is done connecting.
+    if (signal.methodIndex() < RemoteDataReply::staticMetaObject.methodOffset()) return;
+    if (signal == QMetaMethod::fromSignal(&RemoteDataReply::haveDownloadChunk)) return;
+    if (signal == QMetaMethod::fromSignal(&AgaveReplyProxy::haveDownloadSegmentStats)) return;
+
+    callerReady.storeRelease(1);
+    QMetaObject::invokeMethod(this, "deliverHeldSignals", Qt::QueuedConnection);
+}
+
+void AgaveReplyProxy::relaySignal(QMetaMethod proxySignal, void ** signalArgs)
+{
+    HeldSignal newSignal;
+    newSignal.signalMethod = proxySignal;
+    for (int i = 0; i < newSignal.signalMethod.parameterCount(); i++)
+    {
+        newSignal.signalArgs.append(QVariant(newSignal.signalMethod.parameterType(i), signalArgs[i + 1]));
+    }
+    heldSignals.append(newSignal);
+
+    deliverHeldSignals();
+}
+
+void AgaveReplyProxy::deliverHeldSignals()
+{
+    if (callerReady.loadAcquire() == 0) return;
+
+    while (!heldSignals.isEmpty())
+    {
+        emitHeldSignal(heldSignals.takeFirst());
+    }
+    if (requestDone) this->deleteLater();
+}
+
+void AgaveReplyProxy::emitHeldSignal(const HeldSignal &toEmit)
+{
+    QList<QByteArray> typeNames = toEmit.signalMethod.parameterTypes();
+    QGenericArgument signalArgs[10];
+    for (int i = 0; (i < toEmit.signalArgs.size()) && (i < 10); i++)
+    {
+        signalArgs[i] = QGenericArgument(typeNames.at(i).constData(), toEmit.signalArgs.at(i).constData());
+    }
+    toEmit.signalMethod.invoke(this, Qt::DirectConnection,
+                               signalArgs[0], signalArgs[1], signalArgs[2], signalArgs[3], signalArgs[4],
+                               signalArgs[5], signalArgs[6], signalArgs[7], signalArgs[8], signalArgs[9]);
+}
+
+void AgaveReplyProxy::actualRequestDone()
+{
+    requestDone = true;
+    //Held signals keep the proxy until the caller has them
+    if (heldSignals.isEmpty()) this->deleteLater();
+}
+
+void AgaveReplyProxy::settingsChanged()
+{
+    //Before the request is made, attachRequest picks the settings up
+    QMetaObject::invokeMethod(this, "applyRequestSettings", Qt::QueuedConnection);
+}
+
+void AgaveReplyProxy::applyRequestSettings()
+{
+    if (!requestAttached || myRequest.isNull()) return;
+
+    settingsLock.lock();
+    bool doUnconnected = hasUnconnected;
+    bool doPriority = hasPriority;
+    RequestPriority newPriority = requestPriority;
+    QObject * newClient = requestClient;
+    bool doCancel = hasCancel;
+    hasUnconnected = false;
+    hasPriority = false;
+    hasCancel = false;
+    settingsLock.unlock();
+
+    if (doUnconnected) myRequest->setAsUnconnectedReply();
+    if (doPriority) myRequest->setRequestPriority(newPriority, newClient);
+    if (doCancel) myRequest->cancel();
+}
@@ -0,0 +1,121 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVEREPLYPROXY_H
+#define AGAVEREPLYPROXY_H
+
+#include "remotedatainterface.h"
+
+#include <QPointer>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QMetaMethod>
+#include <QVariant>
+#include <QList>
+
+/*! \brief The AgaveReplyProxy stands in for the reply to a request made from outside the AgaveHandler's thread.
+ *
+ *  The proxy is returned at once, while the request itself waits in the AgaveHandler's submission
+ *  queue. Once the request is made, in the AgaveHandler's thread, every RemoteDataReply signal of
+ *  the actual reply is given again by the proxy, which is deleted along with the actual reply.
+ *
+ *  Signals of the actual reply are held by the proxy until the caller has connected to one of the
+ *  result signals, or called setAsUnconnectedReply, and are then given in the order they came.
+ *  haveDownloadChunk and haveDownloadSegmentStats do not count, so they should be connected before the result signal.
+ *  A proxy that is never connected keeps its result until the AgaveHandler is destroyed.
+ *
+ *  setAsUnconnectedReply, setRequestPriority and cancel may be called from any thread. They are
+ *  passed on to the actual reply from the AgaveHandler's thread.
+ */
+
+class AgaveReplyProxy : public RemoteDataReply
+{
+    Q_OBJECT
+
+    friend class AgaveReplySignalRelay;
+
+public:
+    explicit AgaveReplyProxy();
+
+    virtual void setAsUnconnectedReply();
+    virtual void setRequestPriority(RequestPriority newPriority, QObject * client = nullptr);
+
+    void attachRequest(RemoteDataReply * actualReply);
+
+public slots:
+    virtual void cancel();
+
+signals:
+    //As given by AgaveTaskReply, for segmented downloads
+    void haveDownloadSegmentStats(int segmentNum, qint64 segmentBytes, qint64 elapsedMsecs);
+
+protected:
+    virtual void connectNotify(const QMetaMethod &signal);
+
+private slots:
+    void applyRequestSettings();
+    void deliverHeldSignals();
+    void actualRequestDone();
+
+private:
+    struct HeldSignal
+    {
+        QMetaMethod signalMethod;
+        QList<QVariant> signalArgs;
+    };
+
+    void settingsChanged();
+    void relaySignal(QMetaMethod proxySignal, void ** signalArgs);
+    void emitHeldSignal(const HeldSignal &toEmit);
+
+    QPointer<RemoteDataReply> myRequest;
+    bool requestAttached = false;
+    bool requestDone = false;
+
+    //Signals of the actual reply, waiting for the caller, used only in the AgaveHandler's thread
+    QList<HeldSignal> heldSignals;
+
+    //Settings given before they could be passed on, guarded by settingsLock:
+    QMutex settingsLock;
+    bool hasUnconnected = false;
+    bool hasPriority = false;
+    RequestPriority requestPriority = RequestPriority::INTERACTIVE;
+    QObject * requestClient = nullptr;
+    bool hasCancel = false;
+
+    QAtomicInt callerReady;
+};
+
+#endif // AGAVEREPLYPROXY_H
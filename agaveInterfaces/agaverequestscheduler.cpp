@@ -0,0 +1,194 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaverequestscheduler.h"
+
+#include "agavehandler.h"
+#include "agavetaskreply.h"
+
+AgaveRequestScheduler::AgaveRequestScheduler(AgaveHandler * theManager) : QObject(theManager)
+{
+    myManager = theManager;
+
+    //QNetworkAccessManager opens at most 6 HTTP/1.1 connections per host and queues the rest.
+    //Background and bulk together stay below that, so an interactive request always finds a free one.
+    classList.resize(3);
+    classList[static_cast<int>(RequestPriority::INTERACTIVE)].maxInFlight = 4;
+    classList[static_cast<int>(RequestPriority::BACKGROUND)].maxInFlight = 2;
+    classList[static_cast<int>(RequestPriority::BULK)].maxInFlight = 3;
+}
+
+void AgaveRequestScheduler::enqueueRequest(AgaveTaskReply * newRequest)
+{
+    incomingRequests.append(newRequest);
+    scheduleDispatch();
+}
+
+void AgaveRequestScheduler::enqueueRawRequest(RequestPriority priorityClass, QObject * client, QObject * owner, std::function<QNetworkReply *()> sendCall)
+{
+    QueuedRequest newRequest;
+    newRequest.isRaw = true;
+    newRequest.rawOwner = owner;
+    newRequest.rawSend = sendCall;
+    queueForClient(&classList[static_cast<int>(priorityClass)], client, newRequest);
+    scheduleDispatch();
+}
+
+void AgaveRequestScheduler::setMaxInFlight(RequestPriority priorityClass, int newMax)
+{
+    if (newMax < 1) return;
+    classList[static_cast<int>(priorityClass)].maxInFlight = newMax;
+    scheduleDispatch();
+}
+
+int AgaveRequestScheduler::getMaxInFlight(RequestPriority priorityClass)
+{
+    return classList.at(static_cast<int>(priorityClass)).maxInFlight;
+}
+
+int AgaveRequestScheduler::queuedRequestCount()
+{
+    int ret = incomingRequests.size();
+    for (const PriorityClass &aClass : classList)
+    {
+        for (auto itr = aClass.clientQueues.cbegin(); itr != aClass.clientQueues.cend(); itr++)
+        {
+            ret += itr.value().size();
+        }
+    }
+    return ret;
+}
+
+void AgaveRequestScheduler::dispatchQueuedRequests()
+{
+    dispatchScheduled = false;
+
+    //By now, callers have had the chance to set priorities, so new requests can be sorted
+    for (QPointer<AgaveTaskReply> aRequest : incomingRequests)
+    {
+        if (aRequest.isNull()) continue;
+
+        QueuedRequest newRequest;
+        newRequest.taskRequest = aRequest;
+        queueForClient(&classList[static_cast<int>(aRequest->getRequestPriority())], aRequest->getRequestClient(), newRequest);
+    }
+    incomingRequests.clear();
+
+    for (int i = 0; i < classList.size(); i++)
+    {
+        PriorityClass &theClass = classList[i];
+        QueuedRequest nextRequest;
+        while ((theClass.inFlight < theClass.maxInFlight) && takeNextRequest(&theClass, &nextRequest))
+        {
+            QNetworkReply * sentReply = nullptr;
+            if (nextRequest.isRaw)
+            {
+                sentReply = nextRequest.rawSend();
+            }
+            else
+            {
+                sentReply = myManager->dispatchRequest(nextRequest.taskRequest);
+            }
+            //No new reply if the request failed, or joined an identical one in flight
+            if (sentReply == nullptr) continue;
+
+            theClass.inFlight++;
+            sentReply->setProperty("requestPriority", i);
+            QObject::connect(sentReply, SIGNAL(finished()), this, SLOT(requestFinished()));
+        }
+    }
+}
+
+void AgaveRequestScheduler::requestFinished()
+{
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    if (theReply == nullptr) return;
+
+    int classNum = theReply->property("requestPriority").toInt();
+    if ((classNum < 0) || (classNum >= classList.size())) return;
+
+    classList[classNum].inFlight--;
+    if (classList[classNum].inFlight < 0) classList[classNum].inFlight = 0;
+
+    scheduleDispatch();
+}
+
+void AgaveRequestScheduler::queueForClient(PriorityClass * theClass, QObject * theClient, QueuedRequest newRequest)
+{
+    if (!theClass->clientQueues.contains(theClient))
+    {
+        theClass->clientRing.append(theClient);
+    }
+    theClass->clientQueues[theClient].append(newRequest);
+}
+
+void AgaveRequestScheduler::scheduleDispatch()
+{
+    if (dispatchScheduled) return;
+    dispatchScheduled = true;
+    QMetaObject::invokeMethod(this, "dispatchQueuedRequests", Qt::QueuedConnection);
+}
+
+bool AgaveRequestScheduler::takeNextRequest(PriorityClass * theClass, QueuedRequest * nextRequest)
+{
+    while (!theClass->clientRing.isEmpty())
+    {
+        if (theClass->nextClient >= theClass->clientRing.size()) theClass->nextClient = 0;
+
+        QObject * theClient = theClass->clientRing.at(theClass->nextClient);
+        QList<QueuedRequest> &clientQueue = theClass->clientQueues[theClient];
+
+        bool foundRequest = false;
+        while (!foundRequest && !clientQueue.isEmpty())
+        {
+            *nextRequest = clientQueue.takeFirst();
+            foundRequest = nextRequest->isRaw ? !nextRequest->rawOwner.isNull() : !nextRequest->taskRequest.isNull();
+        }
+
+        if (clientQueue.isEmpty())
+        {
+            //The ring position now holds the following client, so it is next in line
+            theClass->clientQueues.remove(theClient);
+            theClass->clientRing.removeAt(theClass->nextClient);
+        }
+        else
+        {
+            theClass->nextClient++;
+        }
+
+        if (foundRequest) return true;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVEREQUESTSCHEDULER_H
+#define AGAVEREQUESTSCHEDULER_H
+
+#include "remotedatainterface.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+class AgaveHandler;
+class AgaveTaskReply;
+class QNetworkReply;
+
+/*! \brief The AgaveRequestScheduler decides when each queued Agave request is actually sent.
+ *
+ *  Requests wait in one of three priority classes (see RequestPriority). Each class has its own
+ *  limit on requests in flight, so a long run of bulk transfers cannot hold up interactive
+ *  requests, while still using all of its own slots. Within a class, each client (the object
+ *  given to setRequestPriority) gets its own queue, and queues are served round-robin.
+ *
+ *  Queued requests are sent from the event loop, so a caller has the chance to set the priority
+ *  of a reply before it is classified.
+ *
+ *  Requests that are not AgaveTaskReplies, such as the ranges of a segmented download, take
+ *  their slots through enqueueRawRequest, with their class given up front.
+ */
+
+class AgaveRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AgaveRequestScheduler(AgaveHandler * theManager);
+
+    void enqueueRequest(AgaveTaskReply * newRequest);
+    //sendCall is made once a slot is free, unless owner is gone by then, and gives the reply holding the slot
+    void enqueueRawRequest(RequestPriority priorityClass, QObject * client, QObject * owner, std::function<QNetworkReply *()> sendCall);
+    void setMaxInFlight(RequestPriority priorityClass, int newMax);
+    int getMaxInFlight(RequestPriority priorityClass);
+    int queuedRequestCount();
+
+private slots:
+    void dispatchQueuedRequests();
+    void requestFinished();
+
+private:
+    struct QueuedRequest
+    {
+        QPointer<AgaveTaskReply> taskRequest;
+        bool isRaw = false;
+        QPointer<QObject> rawOwner;
+        std::function<QNetworkReply *()> rawSend;
+    };
+
+    struct PriorityClass
+    {
+        int maxInFlight = 1;
+        int inFlight = 0;
+        QList<QObject *> clientRing;
+        int nextClient = 0;
+        QHash<QObject *, QList<QueuedRequest>> clientQueues;
+    };
+
+    void queueForClient(PriorityClass * theClass, QObject * theClient, QueuedRequest newRequest);
+    void scheduleDispatch();
+    bool takeNextRequest(PriorityClass * theClass, QueuedRequest * nextRequest);
+
+    AgaveHandler * myManager;
+
+    QList<QPointer<AgaveTaskReply>> incomingRequests;
+    QVector<PriorityClass> classList;
+    bool dispatchScheduled = false;
+};
+
+#endif // AGAVEREQUESTSCHEDULER_H
@@ -0,0 +1,133 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveresponsecache.h"
+
+AgaveResponseCache::AgaveResponseCache() {}
+
+void AgaveResponseCache::setTimeToLive(qint64 msecs)
+{
+    if (msecs < 0) return;
+    timeToLive = msecs;
+}
+
+void AgaveResponseCache::setMaxEntries(int newMax)
+{
+    if (newMax < 1) return;
+    maxEntries = newMax;
+    while (entryList.size() > maxEntries)
+    {
+        evictOldest();
+    }
+}
+
+bool AgaveResponseCache::hasFreshEntry(QString key)
+{
+    if (!entryList.contains(key)) return false;
+
+    //Replies with validators are always revalidated, which costs only a 304
+    const CacheEntry &theEntry = entryList[key];
+    if (!theEntry.eTag.isEmpty() || !theEntry.lastModified.isEmpty()) return false;
+    return (theEntry.age.elapsed() < timeToLive);
+}
+
+bool AgaveResponseCache::hasEntry(QString key)
+{
+    return entryList.contains(key);
+}
+
+QMap<QByteArray, QByteArray> AgaveResponseCache::getValidatorHeaders(QString key, bool eTagOnly)
+{
+    QMap<QByteArray, QByteArray> ret;
+    if (!entryList.contains(key)) return ret;
+
+    const CacheEntry &theEntry = entryList[key];
+    if (!theEntry.eTag.isEmpty())
+    {
+        ret.insert("If-None-Match", theEntry.eTag);
+    }
+    if (!eTagOnly && !theEntry.lastModified.isEmpty())
+    {
+        ret.insert("If-Modified-Since", theEntry.lastModified);
+    }
+    return ret;
+}
+
+QByteArray AgaveResponseCache::getBody(QString key)
+{
+    if (!entryList.contains(key)) return QByteArray();
+    return entryList[key].body;
+}
+
+void AgaveResponseCache::storeEntry(QString key, QByteArray body, QByteArray eTag, QByteArray lastModified)
+{
+    if (!entryList.contains(key) && (entryList.size() >= maxEntries))
+    {
+        evictOldest();
+    }
+
+    CacheEntry &theEntry = entryList[key];
+    theEntry.body = body;
+    theEntry.eTag = eTag;
+    theEntry.lastModified = lastModified;
+    theEntry.age.start();
+}
+
+void AgaveResponseCache::refreshEntry(QString key)
+{
+    if (!entryList.contains(key)) return;
+    entryList[key].age.start();
+}
+
+void AgaveResponseCache::clear()
+{
+    entryList.clear();
+}
+
+void AgaveResponseCache::evictOldest()
+{
+    auto oldest = entryList.end();
+    for (auto itr = entryList.begin(); itr != entryList.end(); itr++)
+    {
+        if ((oldest == entryList.end()) || (itr->age.elapsed() > oldest->age.elapsed()))
+        {
+            oldest = itr;
+        }
+    }
+    if (oldest != entryList.end())
+    {
+        entryList.erase(oldest);
+    }
+}
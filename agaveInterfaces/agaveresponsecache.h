@@ -0,0 +1,89 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVERESPONSECACHE_H
+#define AGAVERESPONSECACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QElapsedTimer>
+
+/*! \brief The AgaveResponseCache keeps recent replies to read-only Agave requests.
+ *
+ *  When a cached reply came with an ETag or Last-Modified header, the next identical request is
+ *  sent as a conditional request, and a 304 reply is answered from the cache. A reply without
+ *  either header is reused as-is for a short time to live, without asking the server at all.
+ *  Tasks cached by ETag only, such as job details, skip the time to live and Last-Modified.
+ *
+ *  Entries are keyed by task and resolved URL. The whole cache is dropped whenever a request
+ *  that changes remote data is sent, so a listing is never served stale after an upload or move.
+ */
+
+class AgaveResponseCache
+{
+public:
+    explicit AgaveResponseCache();
+
+    void setTimeToLive(qint64 msecs);
+    void setMaxEntries(int newMax);
+
+    bool hasFreshEntry(QString key);
+    bool hasEntry(QString key);
+    QMap<QByteArray, QByteArray> getValidatorHeaders(QString key, bool eTagOnly = false);
+    QByteArray getBody(QString key);
+
+    void storeEntry(QString key, QByteArray body, QByteArray eTag, QByteArray lastModified);
+    void refreshEntry(QString key);
+    void clear();
+
+private:
+    struct CacheEntry
+    {
+        QByteArray body;
+        QByteArray eTag;
+        QByteArray lastModified;
+        QElapsedTimer age;
+    };
+
+    void evictOldest();
+
+    QHash<QString, CacheEntry> entryList;
+    qint64 timeToLive = 10000;
+    int maxEntries = 256;
+};
+
+#endif // AGAVERESPONSECACHE_H
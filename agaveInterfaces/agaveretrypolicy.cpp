@@ -0,0 +1,161 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveretrypolicy.h"
+
+#include "agavetaskreply.h"
+
+#include <QNetworkReply>
+#include <QDateTime>
+#include <QLocale>
+#include <QRandomGenerator>
+
+AgaveRetryPolicy::AgaveRetryPolicy()
+{
+    budgetClock.start();
+}
+
+void AgaveRetryPolicy::setMaxAttempts(int newMax)
+{
+    if (newMax < 1) return;
+    maxAttempts = newMax;
+}
+
+void AgaveRetryPolicy::setBackoff(qint64 baseMsecs, qint64 maxMsecs)
+{
+    if ((baseMsecs < 1) || (maxMsecs < baseMsecs)) return;
+    baseDelay = baseMsecs;
+    maxDelay = maxMsecs;
+}
+
+void AgaveRetryPolicy::setRetryBudget(int maxRetries, qint64 windowMsecs)
+{
+    if ((maxRetries < 0) || (windowMsecs < 1)) return;
+    budgetSize = maxRetries;
+    budgetWindow = windowMsecs;
+}
+
+bool AgaveRetryPolicy::isRetryableFailure(QNetworkReply * failedReply)
+{
+    if (failedReply == nullptr) return false;
+
+    int statusCode = failedReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if ((statusCode == 429) || (statusCode == 502) || (statusCode == 503) || (statusCode == 504))
+    {
+        return true;
+    }
+
+    //Any other reply from the server is an answer, and asking again will not change it
+    if (statusCode != 0) return false;
+
+    return AgaveTaskReply::isTransientNetworkError(failedReply->error());
+}
+
+qint64 AgaveRetryPolicy::takeRetryDelay(QNetworkReply * failedReply, int attemptsSoFar)
+{
+    if (attemptsSoFar >= maxAttempts) return -1;
+    if (!isRetryableFailure(failedReply)) return -1;
+    if (!budgetAvailable()) return -1;
+
+    qint64 ret = -1;
+    if (failedReply->hasRawHeader("Retry-After"))
+    {
+        ret = parseRetryAfter(failedReply->rawHeader("Retry-After"));
+        //A server that asks for a long wait is effectively down, so the caller should hear of it
+        if (ret > maxRetryAfter) return -1;
+    }
+
+    if (ret < 0)
+    {
+        return takeBackoffDelay(attemptsSoFar);
+    }
+
+    recentRetries.append(budgetClock.elapsed());
+    return ret;
+}
+
+qint64 AgaveRetryPolicy::takeRetryDelay(int attemptsSoFar)
+{
+    if (attemptsSoFar >= maxAttempts) return -1;
+    if (!budgetAvailable()) return -1;
+
+    return takeBackoffDelay(attemptsSoFar);
+}
+
+qint64 AgaveRetryPolicy::takeBackoffDelay(int attemptsSoFar)
+{
+    //Exponential backoff, with up to half of the wait taken off at random
+    qint64 ceiling = baseDelay;
+    for (int i = 0; (i < attemptsSoFar) && (ceiling < maxDelay); i++)
+    {
+        ceiling *= 2;
+    }
+    if (ceiling > maxDelay) ceiling = maxDelay;
+
+    recentRetries.append(budgetClock.elapsed());
+    return ceiling / 2 + QRandomGenerator::global()->bounded(ceiling / 2 + 1);
+}
+
+qint64 AgaveRetryPolicy::parseRetryAfter(QByteArray headerValue)
+{
+    headerValue = headerValue.trimmed();
+
+    bool isNumber = false;
+    qint64 delaySecs = headerValue.toLongLong(&isNumber);
+    if (isNumber)
+    {
+        if (delaySecs < 0) return -1;
+        return delaySecs * 1000;
+    }
+
+    //Otherwise, an HTTP date, such as: Wed, 21 Oct 2015 07:28:00 GMT
+    QDateTime retryTime = QLocale::c().toDateTime(QString::fromLatin1(headerValue), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+    if (!retryTime.isValid()) return -1;
+    retryTime.setTimeSpec(Qt::UTC);
+
+    qint64 ret = QDateTime::currentDateTimeUtc().msecsTo(retryTime);
+    if (ret < 0) return 0;
+    return ret;
+}
+
+bool AgaveRetryPolicy::budgetAvailable()
+{
+    qint64 windowStart = budgetClock.elapsed() - budgetWindow;
+    while (!recentRetries.isEmpty() && (recentRetries.first() < windowStart))
+    {
+        recentRetries.removeFirst();
+    }
+    return (recentRetries.size() < budgetSize);
+}
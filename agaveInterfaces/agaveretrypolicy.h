@@ -0,0 +1,89 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVERETRYPOLICY_H
+#define AGAVERETRYPOLICY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QElapsedTimer>
+
+class QNetworkReply;
+
+/*! \brief The AgaveRetryPolicy decides whether, and after how long, a failed Agave request is sent again.
+ *
+ *  Only transient failures are retried: dropped connections, timeouts and the like, as well as
+ *  HTTP 429, 502, 503 and 504. The wait doubles with each attempt, up to a cap, and a random
+ *  amount of it is taken off so that many failed requests do not all come back at once.
+ *  A Retry-After header from the server overrides the computed wait.
+ *
+ *  All retries also draw on a shared budget per time window, so a server that is truly down is
+ *  not hammered by every queued request in turn. Once the budget is spent, failures are
+ *  reported to the caller as usual.
+ */
+
+class AgaveRetryPolicy
+{
+public:
+    explicit AgaveRetryPolicy();
+
+    void setMaxAttempts(int newMax);
+    void setBackoff(qint64 baseMsecs, qint64 maxMsecs);
+    void setRetryBudget(int maxRetries, qint64 windowMsecs);
+
+    bool isRetryableFailure(QNetworkReply * failedReply);
+    //Returns the wait before the next attempt, or -1 if the request should not be retried
+    qint64 takeRetryDelay(QNetworkReply * failedReply, int attemptsSoFar);
+    //As above, for a failure already known to be transient, such as a transfer cut short without error
+    qint64 takeRetryDelay(int attemptsSoFar);
+
+    static qint64 parseRetryAfter(QByteArray headerValue);
+
+private:
+    bool budgetAvailable();
+    qint64 takeBackoffDelay(int attemptsSoFar);
+
+    int maxAttempts = 4;
+    qint64 baseDelay = 500;
+    qint64 maxDelay = 30000;
+    qint64 maxRetryAfter = 300000;
+
+    int budgetSize = 30;
+    qint64 budgetWindow = 60000;
+    QList<qint64> recentRetries;
+    QElapsedTimer budgetClock;
+};
+
+#endif // AGAVERETRYPOLICY_H
@@ -0,0 +1,386 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agavesegmenteddownload.h"
+
+#include "agavehandler.h"
+#include "agavetaskreply.h"
+#include "agaverequestscheduler.h"
+
+#include <QTimer>
+
+AgaveSegmentedDownload::AgaveSegmentedDownload(AgaveHandler * theManager, QString remoteName, QString localDest, int segmentCount, QObject * parent) :
+    QObject(parent), downloadTarget(localDest)
+{
+    myManager = theManager;
+    remoteFileName = remoteName;
+    maxSegments = qMax(1, segmentCount);
+}
+
+AgaveSegmentedDownload::~AgaveSegmentedDownload()
+{
+    downloadFinished = true;
+    for (DownloadSegment &aSegment : segmentList)
+    {
+        if (aSegment.activeReply != nullptr)
+        {
+            aSegment.activeReply->abort();
+            aSegment.activeReply->deleteLater();
+            aSegment.activeReply = nullptr;
+        }
+    }
+}
+
+void AgaveSegmentedDownload::start()
+{
+    if (downloadFinished) return;
+
+    if (!downloadTarget.open())
+    {
+        finishDownload(RequestState::LOCAL_FILE_ERROR);
+        return;
+    }
+
+    //The first segment doubles as the probe for the total file size
+    DownloadSegment probeSegment;
+    probeSegment.rangeEnd = minSegmentSize - 1;
+    segmentList.append(probeSegment);
+
+    requestSegment(0);
+}
+
+void AgaveSegmentedDownload::cancel()
+{
+    finishDownload(RequestState::STOPPED_BY_USER);
+}
+
+void AgaveSegmentedDownload::segmentMetaDataReady()
+{
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    int segmentNum = segmentNumFor(theReply);
+    if ((segmentNum < 0) || (theReply->error() != QNetworkReply::NoError)) return;
+
+    int statusCode = theReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (statusCode == 206)
+    {
+        qint64 replyStart = -1;
+        qint64 totalSize = -1;
+        if (!AgaveTaskReply::parseContentRange(theReply->rawHeader("Content-Range"), &replyStart, &totalSize)
+                || (replyStart != segmentList.at(segmentNum).attemptStart))
+        {
+            qCDebug(remoteInterface, "ERROR: Segment reply does not match requested range.");
+            theReply->abort();
+            return;
+        }
+
+        if (!totalSizeKnown && (totalSize >= 0))
+        {
+            totalSizeKnown = true;
+            downloadTarget.preallocate(totalSize);
+            planRemainingSegments(totalSize);
+        }
+        return;
+    }
+
+    if ((statusCode == 200) && (segmentNum == 0) && !totalSizeKnown)
+    {
+        //No range support: this one reply carries the whole file
+        singleStream = true;
+        segmentList[0].rangeEnd = -1;
+
+        QVariant contentLength = theReply->header(QNetworkRequest::ContentLengthHeader);
+        if (contentLength.isValid())
+        {
+            downloadTarget.preallocate(contentLength.toLongLong());
+        }
+        qCDebug(remoteInterface, "Server ignored range request, downloading %s as a single stream.", qPrintable(remoteFileName));
+        return;
+    }
+
+    if ((statusCode < 200) || (statusCode >= 300)) return;
+
+    //A full reply to a ranged segment request cannot be placed in the file
+    theReply->abort();
+}
+
+void AgaveSegmentedDownload::segmentDataReady()
+{
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    int segmentNum = segmentNumFor(theReply);
+    if (segmentNum < 0) return;
+
+    if (!drainSegment(segmentNum, theReply))
+    {
+        finishDownload(RequestState::LOCAL_FILE_ERROR);
+    }
+}
+
+void AgaveSegmentedDownload::segmentFinished()
+{
+    QNetworkReply * theReply = qobject_cast<QNetworkReply *>(sender());
+    int segmentNum = segmentNumFor(theReply);
+    if (segmentNum < 0) return;
+
+    DownloadSegment &theSegment = segmentList[segmentNum];
+    theSegment.activeReply = nullptr;
+    theReply->deleteLater();
+
+    if (!drainSegment(segmentNum, theReply))
+    {
+        finishDownload(RequestState::LOCAL_FILE_ERROR);
+        return;
+    }
+
+    if ((segmentNum == 0) && !totalSizeKnown && isEmptyFileReply(theReply))
+    {
+        //An empty file has no bytes for the probe to ask for, so the server refuses the range
+        if (!downloadTarget.commit())
+        {
+            finishDownload(RequestState::LOCAL_FILE_ERROR);
+            return;
+        }
+        finishDownload(RequestState::GOOD);
+        return;
+    }
+
+    if ((theReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 401) && !theSegment.tokenReplayed)
+    {
+        //A second refusal, with a fresh token, is a real one
+        theSegment.tokenReplayed = true;
+        qCDebug(remoteInterface, "Access token refused for download segment %d, replaying after refresh", segmentNum);
+        myManager->waitForTokenRefresh(this, [this, segmentNum](RequestState refreshState) {
+            if (downloadFinished) return;
+            if (refreshState != RequestState::GOOD)
+            {
+                finishDownload(RequestState::REMOTE_SERVER_ERROR);
+                return;
+            }
+            requestSegment(segmentNum);
+        });
+        return;
+    }
+
+    if ((theReply->error() == QNetworkReply::NoError) && segmentComplete(segmentNum))
+    {
+        qint64 attemptBytes = theSegment.rangeStart + theSegment.received - theSegment.attemptStart;
+        qint64 elapsedMsecs = qMax(Q_INT64_C(1), theSegment.attemptTimer.elapsed());
+        qCDebug(remoteInterface, "Download segment %d: %lld bytes in %lld ms (%lld KB/s)",
+                segmentNum, attemptBytes, elapsedMsecs, (attemptBytes / elapsedMsecs) * 1000 / 1024);
+        emit segmentStats(segmentNum, attemptBytes, elapsedMsecs);
+
+        for (int i = 0; i < segmentList.size(); i++)
+        {
+            if (!segmentComplete(i) || (segmentList.at(i).activeReply != nullptr)) return;
+        }
+
+        if (!downloadTarget.commit())
+        {
+            finishDownload(RequestState::LOCAL_FILE_ERROR);
+            return;
+        }
+        finishDownload(RequestState::GOOD);
+        return;
+    }
+
+    //Only this segment is fetched again, starting where it left off, after the same backoff as other requests
+    RequestState failState = RequestState::MISSING_REPLY_DATA;
+    qint64 retryDelay = -1;
+    if (theReply->error() != QNetworkReply::NoError)
+    {
+        failState = AgaveTaskReply::interpretNetworkError(theReply);
+        if (!singleStream) retryDelay = myManager->retryPolicy.takeRetryDelay(theReply, theSegment.attempts);
+    }
+    else if (!singleStream)
+    {
+        //Cut short without error, which a fresh connection may well finish
+        retryDelay = myManager->retryPolicy.takeRetryDelay(theSegment.attempts);
+    }
+
+    theSegment.attempts++;
+    if (retryDelay < 0)
+    {
+        finishDownload(failState);
+        return;
+    }
+
+    qCDebug(remoteInterface, "Retrying download segment %d from byte %lld in %lld ms", segmentNum, theSegment.rangeStart + theSegment.received, retryDelay);
+    QTimer::singleShot(static_cast<int>(retryDelay), this, [this, segmentNum]() {
+        if (downloadFinished) return;
+        requestSegment(segmentNum);
+    });
+}
+
+void AgaveSegmentedDownload::requestSegment(int segmentNum)
+{
+    //Segments of this download share one client queue, so other transfers get their turn
+    myManager->requestScheduler->enqueueRawRequest(RequestPriority::BULK, this->parent(), this,
+                                                   [this, segmentNum]() { return sendSegment(segmentNum); });
+}
+
+QNetworkReply * AgaveSegmentedDownload::sendSegment(int segmentNum)
+{
+    if (downloadFinished) return nullptr;
+
+    DownloadSegment &theSegment = segmentList[segmentNum];
+    theSegment.attemptStart = theSegment.rangeStart + theSegment.received;
+
+    QNetworkReply * newReply = myManager->performRangeRequest(remoteFileName, theSegment.attemptStart, theSegment.rangeEnd);
+    if (newReply == nullptr)
+    {
+        finishDownload(RequestState::INTERNAL_ERROR);
+        return nullptr;
+    }
+
+    theSegment.activeReply = newReply;
+    theSegment.attemptTimer.start();
+
+    QObject::connect(newReply, SIGNAL(metaDataChanged()), this, SLOT(segmentMetaDataReady()));
+    QObject::connect(newReply, SIGNAL(readyRead()), this, SLOT(segmentDataReady()));
+    QObject::connect(newReply, SIGNAL(finished()), this, SLOT(segmentFinished()));
+    return newReply;
+}
+
+void AgaveSegmentedDownload::planRemainingSegments(qint64 totalSize)
+{
+    DownloadSegment &probeSegment = segmentList[0];
+    if (totalSize <= probeSegment.rangeEnd + 1)
+    {
+        probeSegment.rangeEnd = totalSize - 1;
+        return;
+    }
+
+    qint64 nextStart = probeSegment.rangeEnd + 1;
+    qint64 remaining = totalSize - nextStart;
+    qint64 segmentSize = qMax(minSegmentSize, (remaining + maxSegments - 1) / maxSegments);
+
+    while (nextStart < totalSize)
+    {
+        DownloadSegment newSegment;
+        newSegment.rangeStart = nextStart;
+        newSegment.rangeEnd = qMin(nextStart + segmentSize, totalSize) - 1;
+        segmentList.append(newSegment);
+        nextStart = newSegment.rangeEnd + 1;
+    }
+
+    qCDebug(remoteInterface, "Downloading %s in %d segments", qPrintable(remoteFileName), segmentList.size());
+
+    for (int i = 1; i < segmentList.size(); i++)
+    {
+        requestSegment(i);
+    }
+}
+
+bool AgaveSegmentedDownload::drainSegment(int segmentNum, QNetworkReply * theReply)
+{
+    if (theReply->error() != QNetworkReply::NoError) return true;
+    int statusCode = theReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if ((statusCode != 206) && !((statusCode == 200) && singleStream && (segmentNum == 0))) return true;
+
+    DownloadSegment &theSegment = segmentList[segmentNum];
+
+    while (theReply->bytesAvailable() > 0)
+    {
+        QByteArray chunk = theReply->read(theReply->bytesAvailable());
+
+        if (theSegment.rangeEnd >= 0)
+        {
+            qint64 spaceLeft = theSegment.rangeEnd - theSegment.rangeStart + 1 - theSegment.received;
+            if (chunk.size() > spaceLeft)
+            {
+                chunk.truncate(static_cast<int>(qMax(Q_INT64_C(0), spaceLeft)));
+            }
+        }
+
+        if (!downloadTarget.writeAt(theSegment.rangeStart + theSegment.received, chunk))
+        {
+            return false;
+        }
+        theSegment.received += chunk.size();
+    }
+    return true;
+}
+
+bool AgaveSegmentedDownload::segmentComplete(int segmentNum)
+{
+    const DownloadSegment &theSegment = segmentList.at(segmentNum);
+    if (theSegment.rangeEnd < 0)
+    {
+        //Single stream: complete once its reply finished without error
+        return (singleStream && (theSegment.activeReply == nullptr) && (theSegment.attempts == 0));
+    }
+    return (theSegment.received >= theSegment.rangeEnd - theSegment.rangeStart + 1);
+}
+
+bool AgaveSegmentedDownload::isEmptyFileReply(QNetworkReply * theReply)
+{
+    //416 Range Not Satisfiable, with Content-Range: bytes */0
+    if (theReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 416) return false;
+    return (theReply->rawHeader("Content-Range").trimmed() == "bytes */0");
+}
+
+int AgaveSegmentedDownload::segmentNumFor(QNetworkReply * theReply)
+{
+    if (downloadFinished || (theReply == nullptr)) return -1;
+
+    for (int i = 0; i < segmentList.size(); i++)
+    {
+        if (segmentList.at(i).activeReply == theReply) return i;
+    }
+    return -1;
+}
+
+void AgaveSegmentedDownload::finishDownload(RequestState finalState)
+{
+    if (downloadFinished) return;
+    downloadFinished = true;
+
+    for (DownloadSegment &aSegment : segmentList)
+    {
+        if (aSegment.activeReply != nullptr)
+        {
+            QNetworkReply * toStop = aSegment.activeReply;
+            aSegment.activeReply = nullptr;
+            toStop->abort();
+            toStop->deleteLater();
+        }
+    }
+
+    if (finalState != RequestState::GOOD)
+    {
+        downloadTarget.discard();
+    }
+    emit downloadDone(finalState);
+}
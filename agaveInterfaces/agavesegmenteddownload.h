@@ -0,0 +1,119 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVESEGMENTEDDOWNLOAD_H
+#define AGAVESEGMENTEDDOWNLOAD_H
+
+#include "remotedatainterface.h"
+#include "agavedownloadtarget.h"
+
+#include <QObject>
+#include <QVector>
+#include <QElapsedTimer>
+
+class AgaveHandler;
+class QNetworkReply;
+
+/*! \brief The AgaveSegmentedDownload fetches one remote file over several connections at once.
+ *
+ *  A first ranged request fetches the start of the file and reveals its total size. The rest of
+ *  the file is then split into byte ranges, one per connection, which are fetched concurrently
+ *  and written straight into their place in a preallocated local file. A range that fails is
+ *  re-requested from the last byte received, after the backoff given by the AgaveRetryPolicy,
+ *  without disturbing the others. An empty remote file is recognized by its refused probe.
+ *
+ *  Each range takes a BULK slot from the AgaveRequestScheduler, so one download keeps within the
+ *  class limit. A range refused for an expired token is asked for again once the token is refreshed.
+ *
+ *  If the server does not honor ranges, the first request simply carries the whole file.
+ */
+
+class AgaveSegmentedDownload : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AgaveSegmentedDownload(AgaveHandler * theManager, QString remoteName, QString localDest, int segmentCount, QObject * parent = nullptr);
+    ~AgaveSegmentedDownload();
+
+public slots:
+    void start();
+    void cancel();
+
+signals:
+    void segmentStats(int segmentNum, qint64 segmentBytes, qint64 elapsedMsecs);
+    void downloadDone(RequestState finalState);
+
+private slots:
+    void segmentMetaDataReady();
+    void segmentDataReady();
+    void segmentFinished();
+
+private:
+    struct DownloadSegment
+    {
+        qint64 rangeStart = 0;
+        qint64 rangeEnd = -1; //Inclusive, -1 for open ended
+        qint64 received = 0;
+        qint64 attemptStart = 0;
+        int attempts = 0;
+        bool tokenReplayed = false;
+        QNetworkReply * activeReply = nullptr;
+        QElapsedTimer attemptTimer;
+    };
+
+    void requestSegment(int segmentNum);
+    QNetworkReply * sendSegment(int segmentNum);
+    void planRemainingSegments(qint64 totalSize);
+    bool drainSegment(int segmentNum, QNetworkReply * theReply);
+    bool segmentComplete(int segmentNum);
+    static bool isEmptyFileReply(QNetworkReply * theReply);
+    int segmentNumFor(QNetworkReply * theReply);
+    void finishDownload(RequestState finalState);
+
+    AgaveHandler * myManager;
+    QString remoteFileName;
+    AgaveDownloadTarget downloadTarget;
+
+    int maxSegments;
+    QVector<DownloadSegment> segmentList;
+    bool totalSizeKnown = false;
+    bool singleStream = false;
+    bool downloadFinished = false;
+
+    const qint64 minSegmentSize = 4194304;
+};
+
+#endif // AGAVESEGMENTEDDOWNLOAD_H
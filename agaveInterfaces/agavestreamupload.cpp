@@ -0,0 +1,158 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agavestreamupload.h"
+
+#include "remotedatainterface.h"
+
+#include <QUuid>
+
+AgaveStreamUpload::AgaveStreamUpload(QIODevice * source, QString newFileName, qint64 expectedSize, QObject * parent) :
+    QIODevice(parent)
+{
+    sourceDevice = source;
+    sourceSize = expectedSize;
+
+    boundary = "agave-";
+    boundary.append(QUuid::createUuid().toByteArray().toHex());
+
+    partHeader = "--";
+    partHeader.append(boundary).append("\r\n");
+    partHeader.append("Content-Type: application/octet-stream\r\n");
+    partHeader.append(QString("Content-Disposition: form-data; name=\"fileToUpload\"; filename=\"%1\"\r\n\r\n").arg(newFileName).toUtf8());
+
+    partTrailer = "\r\n--";
+    partTrailer.append(boundary).append("--\r\n");
+
+    if (sourceDevice != nullptr)
+    {
+        QObject::connect(sourceDevice, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+        QObject::connect(sourceDevice, SIGNAL(readChannelFinished()), this, SLOT(sourceFinished()));
+    }
+
+    open(QIODevice::ReadOnly);
+}
+
+bool AgaveStreamUpload::isSequential() const
+{
+    return true;
+}
+
+qint64 AgaveStreamUpload::bytesAvailable() const
+{
+    qint64 ret = (partHeader.size() - headerSent);
+    if (sourceDevice != nullptr)
+    {
+        ret += qMin(sourceDevice->bytesAvailable(), sourceSize - sourceSent);
+    }
+    if (sourceSent >= sourceSize)
+    {
+        ret += (partTrailer.size() - trailerSent);
+    }
+    return ret + QIODevice::bytesAvailable();
+}
+
+bool AgaveStreamUpload::atEnd() const
+{
+    return (trailerSent >= partTrailer.size()) && QIODevice::atEnd();
+}
+
+QByteArray AgaveStreamUpload::getContentType()
+{
+    QByteArray ret = "multipart/form-data; boundary=";
+    ret.append(boundary);
+    return ret;
+}
+
+qint64 AgaveStreamUpload::getContentLength()
+{
+    return partHeader.size() + sourceSize + partTrailer.size();
+}
+
+qint64 AgaveStreamUpload::readData(char * data, qint64 maxSize)
+{
+    qint64 totalRead = serveFraming(&partHeader, &headerSent, data, maxSize);
+    if (headerSent < partHeader.size()) return totalRead;
+
+    if (sourceSent < sourceSize)
+    {
+        if (sourceDevice == nullptr) return -1;
+
+        qint64 toRead = qMin(maxSize - totalRead, sourceSize - sourceSent);
+        qint64 fromSource = sourceDevice->read(data + totalRead, toRead);
+        if (fromSource < 0)
+        {
+            qCDebug(remoteInterface, "ERROR: Upload stream source failed to read.");
+            return -1;
+        }
+        sourceSent += fromSource;
+        totalRead += fromSource;
+
+        if (sourceSent < sourceSize)
+        {
+            if ((fromSource == 0) && (sourceDone || (!sourceDevice->isSequential() && sourceDevice->atEnd())))
+            {
+                qCDebug(remoteInterface, "ERROR: Upload stream source ended %lld bytes short.", sourceSize - sourceSent);
+                return (totalRead > 0) ? totalRead : -1;
+            }
+            //Otherwise, wait for the source to signal readyRead
+            return totalRead;
+        }
+    }
+
+    totalRead += serveFraming(&partTrailer, &trailerSent, data + totalRead, maxSize - totalRead);
+    return totalRead;
+}
+
+qint64 AgaveStreamUpload::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+void AgaveStreamUpload::sourceFinished()
+{
+    sourceDone = true;
+    emit readyRead();
+}
+
+qint64 AgaveStreamUpload::serveFraming(QByteArray * framing, qint64 * framingSent, char * data, qint64 maxSize)
+{
+    qint64 toCopy = qMin(maxSize, framing->size() - *framingSent);
+    if (toCopy <= 0) return 0;
+
+    memcpy(data, framing->constData() + *framingSent, static_cast<size_t>(toCopy));
+    *framingSent += toCopy;
+    return toCopy;
+}
@@ -0,0 +1,89 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef AGAVESTREAMUPLOAD_H
+#define AGAVESTREAMUPLOAD_H
+
+#include <QIODevice>
+#include <QPointer>
+
+/*! \brief The AgaveStreamUpload is the body of an upload fed from another QIODevice.
+ *
+ *  It wraps a (possibly sequential) source device in the multipart/form-data framing Agave
+ *  expects, and hands bytes to the network layer only as they are asked for. Nothing beyond
+ *  the network layer's own small write buffer is held in memory, so generated data of any size
+ *  can be uploaded without first being written to disk.
+ *
+ *  The source must deliver exactly expectedSize bytes, since the Content-Length is fixed up front.
+ *  It is not owned by this object and must outlive the upload.
+ */
+
+class AgaveStreamUpload : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit AgaveStreamUpload(QIODevice * source, QString newFileName, qint64 expectedSize, QObject * parent = nullptr);
+
+    bool isSequential() const;
+    qint64 bytesAvailable() const;
+    bool atEnd() const;
+
+    QByteArray getContentType();
+    qint64 getContentLength();
+
+protected:
+    qint64 readData(char * data, qint64 maxSize);
+    qint64 writeData(const char * data, qint64 maxSize);
+
+private slots:
+    void sourceFinished();
+
+private:
+    qint64 serveFraming(QByteArray * framing, qint64 * framingSent, char * data, qint64 maxSize);
+
+    QPointer<QIODevice> sourceDevice;
+    QByteArray boundary;
+    QByteArray partHeader;
+    QByteArray partTrailer;
+
+    qint64 sourceSize;
+    qint64 headerSent = 0;
+    qint64 sourceSent = 0;
+    qint64 trailerSent = 0;
+    bool sourceDone = false;
+};
+
+#endif // AGAVESTREAMUPLOAD_H
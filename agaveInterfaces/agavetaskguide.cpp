@@ -37,15 +37,24 @@
 
 #include "agavehandler.h"
 
+#include <cstring>
+
 AgaveTaskGuide::AgaveTaskGuide()
 {
     taskId = "INVALID";
+    defaultPriority = RequestPriority::INTERACTIVE;
 }
 
-AgaveTaskGuide::AgaveTaskGuide(QString newID, AgaveRequestType reqType)
+AgaveTaskGuide::AgaveTaskGuide(QString newID, AgaveRequestType reqType, AgaveTaskKind newKind)
 {
     taskId = newID;
+    taskKind = newKind;
     requestType = reqType;
+    defaultPriority = RequestPriority::INTERACTIVE;
+
+    //Reads can always be sent again safely; anything else must opt in
+    retryable = ((reqType == AgaveRequestType::AGAVE_GET) || (reqType == AgaveRequestType::AGAVE_DOWNLOAD)
+                 || (reqType == AgaveRequestType::AGAVE_PIPE_DOWNLOAD) || (reqType == AgaveRequestType::AGAVE_SINK_DOWNLOAD));
 }
 
 QString AgaveTaskGuide::getTaskID()
@@ -53,15 +62,25 @@ QString AgaveTaskGuide::getTaskID()
     return taskId;
 }
 
+AgaveTaskKind AgaveTaskGuide::getTaskKind()
+{
+    return taskKind;
+}
+
 QByteArray AgaveTaskGuide::getURLsuffix()
 {
-    return URLsuffix.toLatin1();
+    if (!formatsCompiled) compileFormats();
+    return compiledSuffix;
 }
 
 QByteArray AgaveTaskGuide::getArgAndURLsuffix(QMap<QString, QByteArray> * varList)
 {
-    QByteArray ret = getURLsuffix();
-    ret.append(fillURLArgList(varList));
+    if (!formatsCompiled) compileFormats();
+
+    QByteArray ret;
+    ret.reserve(compiledSuffix.size() + compiledURLFormat.fixedLength + 64);
+    ret.append(compiledSuffix);
+    fillAnyArgList(&ret, compiledURLFormat, varList, true);
     return ret;
 }
 
@@ -90,48 +109,217 @@ bool AgaveTaskGuide::isInternal()
     return internalTask;
 }
 
+void AgaveTaskGuide::setDefaultPriority(RequestPriority newPriority)
+{
+    defaultPriority = newPriority;
+}
+
+RequestPriority AgaveTaskGuide::getDefaultPriority()
+{
+    return defaultPriority;
+}
+
+void AgaveTaskGuide::setResponseCacheable(bool eTagOnly)
+{
+    responseCacheable = true;
+    cacheByETagOnly = eTagOnly;
+}
+
+bool AgaveTaskGuide::isResponseCacheable()
+{
+    return responseCacheable;
+}
+
+bool AgaveTaskGuide::isCachedByETagOnly()
+{
+    return cacheByETagOnly;
+}
+
+void AgaveTaskGuide::setRetryable(bool newSetting)
+{
+    retryable = newSetting;
+}
+
+bool AgaveTaskGuide::isRetryable()
+{
+    return retryable;
+}
+
 QByteArray AgaveTaskGuide::fillPostArgList(QMap<QString, QByteArray> *argList)
 {
-    return fillAnyArgList(argList, &postVarNames, &postFormat);
+    if (!formatsCompiled) compileFormats();
+
+    QByteArray ret;
+    fillAnyArgList(&ret, compiledPostFormat, argList, false);
+    return ret;
 }
 
 QByteArray AgaveTaskGuide::fillURLArgList(QMap<QString, QByteArray> *argList)
 {
-    //TODO: Check escaping of other chars
-    for (auto itr = argList->begin(); itr != argList->end(); itr++)
+    if (!formatsCompiled) compileFormats();
+
+    QByteArray ret;
+    fillAnyArgList(&ret, compiledURLFormat, argList, true);
+    return ret;
+}
+
+void AgaveTaskGuide::compileFormats()
+{
+    compiledSuffix = URLsuffix.toUtf8();
+    compiledURLFormat = compileFormat(dynURLFormat, urlVarNames);
+    compiledPostFormat = compileFormat(postFormat, postVarNames);
+    formatsCompiled = true;
+}
+
+QString AgaveTaskGuide::encodeFixedValue(QString rawValue)
+{
+    //Encoded as a form value, so that a slash cannot add a path segment either
+    QByteArray ret;
+    appendPercentEncoded(&ret, rawValue.toUtf8(), false);
+    return QString::fromUtf8(ret);
+}
+
+AgaveTaskGuide::CompiledFormat AgaveTaskGuide::compileFormat(QString strFormat, QStringList subNames)
+{
+    CompiledFormat ret;
+    QByteArray rawFormat = strFormat.toUtf8();
+
+    //Without names to fill in, markers are left as they are
+    if (subNames.isEmpty())
     {
-        if (!(*itr).contains('#')) continue;
-        (*itr).replace('#', "%23");
+        FormatSegment wholeText;
+        wholeText.fixedText = rawFormat;
+        ret.segments.append(wholeText);
+        ret.fixedLength = rawFormat.size();
+        return ret;
     }
 
-    return fillAnyArgList(argList, &urlVarNames, &dynURLFormat);
+    QByteArray fixedText;
+    int i = 0;
+    while (i < rawFormat.size())
+    {
+        //%n is filled with the nth name, %nn for more than nine
+        int markerLength = 0;
+        int varNum = 0;
+        if ((rawFormat.at(i) == '%') && (i + 1 < rawFormat.size()) && (rawFormat.at(i + 1) >= '1') && (rawFormat.at(i + 1) <= '9'))
+        {
+            varNum = rawFormat.at(i + 1) - '0';
+            markerLength = 2;
+            if ((i + 2 < rawFormat.size()) && (rawFormat.at(i + 2) >= '0') && (rawFormat.at(i + 2) <= '9')
+                    && ((varNum * 10 + (rawFormat.at(i + 2) - '0')) <= subNames.size()))
+            {
+                varNum = varNum * 10 + (rawFormat.at(i + 2) - '0');
+                markerLength = 3;
+            }
+        }
+
+        if ((markerLength == 0) || (varNum > subNames.size()))
+        {
+            fixedText.append(rawFormat.at(i));
+            i++;
+            continue;
+        }
+
+        if (!fixedText.isEmpty())
+        {
+            FormatSegment textSegment;
+            textSegment.fixedText = fixedText;
+            ret.segments.append(textSegment);
+            ret.fixedLength += fixedText.size();
+            fixedText.clear();
+        }
+
+        FormatSegment varSegment;
+        varSegment.varName = subNames.at(varNum - 1);
+        varSegment.isVar = true;
+        ret.segments.append(varSegment);
+        ret.hasVars = true;
+        i += markerLength;
+    }
+
+    if (!fixedText.isEmpty())
+    {
+        FormatSegment textSegment;
+        textSegment.fixedText = fixedText;
+        ret.segments.append(textSegment);
+        ret.fixedLength += fixedText.size();
+    }
+    return ret;
 }
 
-QByteArray AgaveTaskGuide::fillAnyArgList(QMap<QString, QByteArray> * argList, QList<QString> * subNames, QString * strFormat)
+bool AgaveTaskGuide::fillAnyArgList(QByteArray * dest, const CompiledFormat &theFormat, QMap<QString, QByteArray> * argList, bool isPath)
 {
-    QByteArray empty;
-    if (strFormat == nullptr)
+    if (!theFormat.hasVars)
+    {
+        for (const FormatSegment &aSegment : theFormat.segments)
+        {
+            dest->append(aSegment.fixedText);
+        }
+        return true;
+    }
+
+    if (argList == nullptr)
     {
-        return empty;
+        return false;
     }
 
-    if ((argList == nullptr) || (subNames == nullptr) || (subNames->empty()))
+    //Sized for the worst case, every byte of every value percent-encoded
+    int neededSize = dest->size() + theFormat.fixedLength;
+    for (const FormatSegment &aSegment : theFormat.segments)
     {
-        return strFormat->toLatin1();
+        if (!aSegment.isVar) continue;
+        auto valueItr = argList->constFind(aSegment.varName);
+        if (valueItr == argList->constEnd())
+        {
+            return false;
+        }
+        neededSize += 3 * valueItr->size();
     }
+    dest->reserve(neededSize);
 
-    QString ret = *strFormat;
+    for (const FormatSegment &aSegment : theFormat.segments)
+    {
+        if (aSegment.isVar)
+        {
+            appendPercentEncoded(dest, argList->value(aSegment.varName), isPath);
+        }
+        else
+        {
+            dest->append(aSegment.fixedText);
+        }
+    }
+    return true;
+}
+
+void AgaveTaskGuide::appendPercentEncoded(QByteArray * dest, const QByteArray &rawValue, bool isPath)
+{
+    //RFC 3986: unreserved characters are never encoded, and a path keeps its own delimiters
+    //Form values encode everything else, so that & = + and the like cannot break up the body
+    static const char hexDigits[] = "0123456789ABCDEF";
+    static const char pathChars[] = "/:@!$&'()*+,;=";
 
-    for (auto itr = subNames->cbegin(); itr != subNames->cend(); ++itr)
+    for (const char rawChar : rawValue)
     {
-        if (!argList->contains(*itr))
+        const unsigned char aChar = static_cast<unsigned char>(rawChar);
+        bool keepChar = (((aChar >= 'A') && (aChar <= 'Z')) || ((aChar >= 'a') && (aChar <= 'z'))
+                         || ((aChar >= '0') && (aChar <= '9')) || (aChar == '-') || (aChar == '.')
+                         || (aChar == '_') || (aChar == '~'));
+        if (!keepChar && isPath && (aChar != 0))
         {
-            return empty;
+            keepChar = (strchr(pathChars, aChar) != nullptr);
         }
 
-        ret = ret.arg(QString::fromLatin1(argList->value(*itr)));
+        if (keepChar)
+        {
+            dest->append(rawChar);
+        }
+        else
+        {
+            dest->append('%');
+            dest->append(hexDigits[aChar >> 4]);
+            dest->append(hexDigits[aChar & 0x0F]);
+        }
     }
-    return ret.toLatin1();
 }
 
 void AgaveTaskGuide::setURLsuffix(QString newValue)
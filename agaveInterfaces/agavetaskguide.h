@@ -37,17 +37,27 @@
 #define AGAVETASKGUIDE_H
 
 #include <QStringList>
+#include <QVector>
 
 enum class AgaveRequestType;
+enum class RequestPriority;
 
 enum class AuthHeaderType {NONE, PASSWD, CLIENT, TOKEN, REFRESH};
 
+//What a task gives back, which picks its entry in the handler table of AgaveTaskReply
+//KIND_COUNT must stay last
+enum class AgaveTaskKind {FULL_AUTH, AUTH_STEP1, AUTH_STEP1A, AUTH_STEP2, AUTH_STEP3, AUTH_REFRESH, AUTH_REVOKE, LOGOUT,
+                          DIR_LISTING, FILE_UPLOAD, FILE_DELETE, NEW_FOLDER, RENAME_FILE, FILE_MOVE, FILE_COPY,
+                          FILE_DOWNLOAD, BUFFER_DOWNLOAD, RANGE_DOWNLOAD,
+                          JOB_START, JOB_LIST, JOB_DETAILS, STOP_JOB, DELETE_JOB, APP_LIST,
+                          KIND_COUNT};
+
 //TODO: This whole class, needs more documentation in particular
 class AgaveTaskGuide
 {
 public:
     explicit AgaveTaskGuide();
-    explicit AgaveTaskGuide(QString newID, AgaveRequestType reqType);
+    explicit AgaveTaskGuide(QString newID, AgaveRequestType reqType, AgaveTaskKind newKind);
 
     void setURLsuffix(QString newValue);
     void setHeaderType(AuthHeaderType newValue);
@@ -58,13 +68,23 @@ public:
     void setPostParams(QString format);
     void setPostParams(QString format, QList<QString> subNames);
     void setAsInternal();
+    void setDefaultPriority(RequestPriority newPriority);
+    //A reply cached by ETag only is always revalidated, and is never reused by time to live
+    void setResponseCacheable(bool eTagOnly = false);
+    void setRetryable(bool newSetting);
 
     void setAgaveFullName(QString newFullName);
     void setAgavePWDparam(QString newPWDparam);
     void setAgaveParamList(QStringList newParamList);
     void setAgaveInputList(QStringList newInputList);
 
+    //Done once the guide is set up, before its first request
+    void compileFormats();
+    //URL suffixes and formats are sent as given, so fixed values put in them are encoded first
+    static QString encodeFixedValue(QString rawValue);
+
     QString getTaskID();
+    AgaveTaskKind getTaskKind();
     QByteArray getURLsuffix();
     QByteArray getArgAndURLsuffix(QMap<QString, QByteArray> * varList = nullptr);
     AgaveRequestType getRequestType();
@@ -73,6 +93,10 @@ public:
     QByteArray fillURLArgList(QMap<QString, QByteArray> * argList = nullptr);
     bool isTokenFormat();
     bool isInternal();
+    RequestPriority getDefaultPriority();
+    bool isResponseCacheable();
+    bool isCachedByETagOnly();
+    bool isRetryable();
 
     QString getAgaveFullName();
     QString getAgavePWDparam();
@@ -84,14 +108,35 @@ public:
 
 private:
     QString taskId;
+    AgaveTaskKind taskKind = AgaveTaskKind::JOB_START;
 
     QString URLsuffix = "";
     AgaveRequestType requestType;
     AuthHeaderType headerType = AuthHeaderType::NONE;
 
-    QByteArray fillAnyArgList(QMap<QString, QByteArray> * argList, QList<QString> * subNames, QString * strFormat);
+    //A URL or post format, split at its %1, %2 ... markers
+    struct FormatSegment
+    {
+        QByteArray fixedText;
+        QString varName;
+        bool isVar = false;
+    };
+    struct CompiledFormat
+    {
+        QVector<FormatSegment> segments;
+        int fixedLength = 0;
+        bool hasVars = false;
+    };
+
+    static CompiledFormat compileFormat(QString strFormat, QStringList subNames);
+    static bool fillAnyArgList(QByteArray * dest, const CompiledFormat &theFormat, QMap<QString, QByteArray> * argList, bool isPath);
+    static void appendPercentEncoded(QByteArray * dest, const QByteArray &rawValue, bool isPath);
 
     bool internalTask = false;
+    RequestPriority defaultPriority;
+    bool responseCacheable = false;
+    bool cacheByETagOnly = false;
+    bool retryable = false;
     bool usesTokenFormat = false;
 
     QString postFormat = "";
@@ -99,6 +144,11 @@ private:
     QStringList postVarNames;
     QStringList urlVarNames;
 
+    bool formatsCompiled = false;
+    QByteArray compiledSuffix;
+    CompiledFormat compiledURLFormat;
+    CompiledFormat compiledPostFormat;
+
     QString agaveFullName;
     QString agavePWDparam;
     QStringList agaveParamList;
@@ -37,6 +37,8 @@
 
 #include "agavehandler.h"
 #include "agavetaskguide.h"
+#include "agavedownloadtarget.h"
+#include "agavesegmenteddownload.h"
 
 #include "filemetadata.h"
 #include "remotejobdata.h"
@@ -55,13 +57,14 @@ AgaveTaskReply::AgaveTaskReply(AgaveTaskGuide * theGuide, QNetworkReply * newRep
     {
         qCDebug(remoteInterface, "Agave Task type that does not use QNetworkReply improperly given a QNetworkReply");
         myReplyObject->deleteLater();
+        myReplyObject = nullptr;
         setDelayedDatalessReply(RequestState::INTERNAL_ERROR);
         return;
     }
 
     if (myReplyObject != nullptr)
     {
-        QObject::connect(myReplyObject, SIGNAL(finished()), this, SLOT(rawHttpTaskComplete()));
+        attachNetworkReply(myReplyObject);
     }
     else
     {
@@ -70,6 +73,12 @@ AgaveTaskReply::AgaveTaskReply(AgaveTaskGuide * theGuide, QNetworkReply * newRep
     }
 }
 
+AgaveTaskReply::AgaveTaskReply(AgaveTaskGuide * theGuide, AgaveHandler * theManager, QObject *parent) : RemoteDataReply(parent)
+{
+    //The QNetworkReply is given later, by attachNetworkReply, when the request scheduler sends the request
+    performInitPointerCheck(theGuide, theManager);
+}
+
 AgaveTaskReply::AgaveTaskReply(AgaveTaskGuide * theGuide, RequestState passThruErrorState, AgaveHandler * theManager, QObject *parent) : RemoteDataReply(parent)
 {
     if (!performInitPointerCheck(theGuide, theManager)) return;
@@ -80,6 +89,7 @@ bool AgaveTaskReply::performInitPointerCheck(AgaveTaskGuide * theGuide, AgaveHan
 {
     myManager = theManager;
     myGuide = theGuide;
+    if (myGuide != nullptr) requestPriority = myGuide->getDefaultPriority();
 
     if (myManager == nullptr)
     {
@@ -99,7 +109,13 @@ AgaveTaskReply::~AgaveTaskReply()
 {
     if (myReplyObject != nullptr)
     {
-        myReplyObject->deleteLater();
+        detachNetworkReply();
+    }
+
+    //An uncommitted download target keeps its partial file and journal, for a later resume
+    if (downloadTarget != nullptr)
+    {
+        delete downloadTarget;
     }
 }
 
@@ -108,6 +124,85 @@ QMap<QString, QByteArray> * AgaveTaskReply::getTaskParamList()
     return &taskParamList;
 }
 
+void AgaveTaskReply::attachNetworkReply(QNetworkReply * newReply)
+{
+    myReplyObject = newReply;
+    myReplyObject->setProperty("replyUsers", myReplyObject->property("replyUsers").toInt() + 1);
+
+    QObject::connect(myReplyObject, SIGNAL(finished()), this, SLOT(rawHttpTaskComplete()));
+
+    if (myGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD)
+    {
+        //File downloads are written to disk as they arrive, rather than all at once at the end
+        QObject::connect(myReplyObject, SIGNAL(metaDataChanged()), this, SLOT(rawDownloadMetaDataReady()));
+        QObject::connect(myReplyObject, SIGNAL(readyRead()), this, SLOT(rawDownloadDataReady()));
+    }
+    else if (myGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD)
+    {
+        QObject::connect(myReplyObject, SIGNAL(readyRead()), this, SLOT(rawSinkDataReady()));
+    }
+    else if (myGuide->getTaskKind() == AgaveTaskKind::RANGE_DOWNLOAD)
+    {
+        QObject::connect(myReplyObject, SIGNAL(metaDataChanged()), this, SLOT(rawRangeMetaDataReady()));
+    }
+    else if (myGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_UPLOAD)
+    {
+        QObject::connect(myReplyObject, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(rawUploadProgress(qint64,qint64)));
+    }
+}
+
+void AgaveTaskReply::setRequestPriority(RequestPriority newPriority, QObject * client)
+{
+    requestPriority = newPriority;
+    requestClient = client;
+}
+
+RequestPriority AgaveTaskReply::getRequestPriority()
+{
+    return requestPriority;
+}
+
+QObject * AgaveTaskReply::getRequestClient()
+{
+    return requestClient;
+}
+
+void AgaveTaskReply::setUploadSource(QIODevice * source)
+{
+    uploadSource = source;
+}
+
+QIODevice * AgaveTaskReply::getUploadSource()
+{
+    return uploadSource;
+}
+
+void AgaveTaskReply::detachNetworkReply()
+{
+    QObject::disconnect(myReplyObject, nullptr, this, nullptr);
+
+    //A coalesced QNetworkReply is shared, and only removed by its last user
+    int replyUsers = myReplyObject->property("replyUsers").toInt() - 1;
+    myReplyObject->setProperty("replyUsers", replyUsers);
+    if (replyUsers <= 0)
+    {
+        myReplyObject->deleteLater();
+    }
+    myReplyObject = nullptr;
+}
+
+void AgaveTaskReply::setCachedReply(QByteArray replyBody)
+{
+    cachedReplyBody = replyBody;
+    QMetaObject::invokeMethod(this, "rawCachedTaskComplete", Qt::QueuedConnection);
+}
+
+void AgaveTaskReply::setDownloadSink(QIODevice * sink)
+{
+    downloadSink = sink;
+    hasDownloadSink = (sink != nullptr);
+}
+
 void AgaveTaskReply::setAsUnconnectedReply()
 {
     expectsSignalConnect = false;
@@ -117,9 +212,15 @@ void AgaveTaskReply::setDelayedDatalessReply(RequestState replyState)
 {
     pendingReply = replyState;
 
-    QTimer * quickTimer = new QTimer(qobject_cast<QObject*>(this));
-    QObject::connect(quickTimer, SIGNAL(timeout()), this, SLOT(rawPassThruTaskComplete()));
-    quickTimer->start(1);
+    //Given from the event loop, so the caller can connect to the reply first
+    if (myManager != nullptr)
+    {
+        myManager->deferReply(this);
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, "rawPassThruTaskComplete", Qt::QueuedConnection);
+    }
 }
 
 AgaveTaskGuide * AgaveTaskReply::getTaskGuide()
@@ -127,6 +228,34 @@ AgaveTaskGuide * AgaveTaskReply::getTaskGuide()
     return myGuide;
 }
 
+//Indexed by AgaveTaskKind, so must be kept in the same order
+const AgaveTaskReply::KindHandlers AgaveTaskReply::kindHandlerTable[] = {
+    {&AgaveTaskReply::emptyAuthReply, &AgaveTaskReply::parsedJobReply},         //FULL_AUTH
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //AUTH_STEP1
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //AUTH_STEP1A
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //AUTH_STEP2
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //AUTH_STEP3
+    {&AgaveTaskReply::emptyRefreshReply, &AgaveTaskReply::parsedRefreshReply},  //AUTH_REFRESH
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //AUTH_REVOKE
+    {&AgaveTaskReply::emptyLogoutReply, &AgaveTaskReply::parsedJobReply},       //LOGOUT
+    {&AgaveTaskReply::emptyLSReply, &AgaveTaskReply::parsedLSReply},            //DIR_LISTING
+    {&AgaveTaskReply::emptyUploadReply, &AgaveTaskReply::parsedUploadReply},    //FILE_UPLOAD
+    {&AgaveTaskReply::emptyDeleteReply, &AgaveTaskReply::parsedDeleteReply},    //FILE_DELETE
+    {&AgaveTaskReply::emptyMkdirReply, &AgaveTaskReply::parsedMkdirReply},      //NEW_FOLDER
+    {&AgaveTaskReply::emptyRenameReply, &AgaveTaskReply::parsedRenameReply},    //RENAME_FILE
+    {&AgaveTaskReply::emptyMoveReply, &AgaveTaskReply::parsedMoveReply},        //FILE_MOVE
+    {&AgaveTaskReply::emptyCopyReply, &AgaveTaskReply::parsedCopyReply},        //FILE_COPY
+    {&AgaveTaskReply::emptyDownloadReply, &AgaveTaskReply::parsedJobReply},     //FILE_DOWNLOAD
+    {&AgaveTaskReply::emptyBufferReply, &AgaveTaskReply::parsedJobReply},       //BUFFER_DOWNLOAD
+    {&AgaveTaskReply::emptyRangeReply, &AgaveTaskReply::parsedJobReply},        //RANGE_DOWNLOAD
+    {&AgaveTaskReply::emptyJobReply, &AgaveTaskReply::parsedJobReply},          //JOB_START
+    {&AgaveTaskReply::emptyJobListReply, &AgaveTaskReply::parsedJobListReply},  //JOB_LIST
+    {&AgaveTaskReply::emptyJobDetailsReply, &AgaveTaskReply::parsedJobDetailsReply}, //JOB_DETAILS
+    {&AgaveTaskReply::emptyStopJobReply, &AgaveTaskReply::parsedStopJobReply},  //STOP_JOB
+    {&AgaveTaskReply::emptyDeleteJobReply, &AgaveTaskReply::parsedDeleteJobReply}, //DELETE_JOB
+    {&AgaveTaskReply::emptyAppListReply, &AgaveTaskReply::parsedAppListReply}   //APP_LIST
+};
+
 void AgaveTaskReply::processDatalessReply(RequestState replyState)
 {   
     if (replyState != RequestState::GOOD)
@@ -134,85 +263,14 @@ void AgaveTaskReply::processDatalessReply(RequestState replyState)
         qCDebug(remoteInterface, "Agave Task Fail: %s", qPrintable(RemoteDataInterface::interpretRequestState(replyState)));
     }
 
-    if (myGuide->getTaskID() == "fullAuth")
-    {
-        emit haveAuthReply(replyState);
-    }
-    else if (myGuide->getTaskID() == "authRefresh")
-    {
-        //TODO: Auth refresh needs to be implemented
-        qCDebug(remoteInterface, "Auth refresh fail: Not yet implemented");
-        return;
-    }
-    else if (myGuide->getTaskID() == "dirListing")
-    {
-        emit haveLSReply(replyState, QList<FileMetaData>());
-    }
-    else if (myGuide->getTaskID() == "startedLogout")
-    {
-        emit startedLogout(replyState);
-    }
-    else if ((myGuide->getTaskID() == "fileUpload") || (myGuide->getTaskID() == "filePipeUpload"))
-    {
-        emit haveUploadReply(replyState, FileMetaData());
-    }
-    else if (myGuide->getTaskID() == "fileDelete")
-    {
-        emit haveDeleteReply(replyState, QString());
-    }
-    else if (myGuide->getTaskID() == "newFolder")
-    {
-        emit haveMkdirReply(replyState, FileMetaData());
-    }
-    else if (myGuide->getTaskID() == "renameFile")
-    {
-        emit haveRenameReply(replyState, FileMetaData(), QString());
-    }
-    else if (myGuide->getTaskID() == "fileMove")
-    {
-        emit haveMoveReply(replyState, FileMetaData(), QString());
-    }
-    else if (myGuide->getTaskID() == "fileCopy")
-    {
-        emit haveCopyReply(replyState,FileMetaData());
-    }
-    else if (myGuide->getTaskID() == "fileDownload")
-    {
-        emit haveDownloadReply(replyState, QString());
-    }
-    else if (myGuide->getTaskID() == "filePipeDownload")
-    {
-        emit haveBufferDownloadReply(replyState, nullptr);
-    }
-    else if (myGuide->getTaskID() == "getJobList")
-    {
-        emit haveJobList(replyState, QList<RemoteJobData>());
-    }
-    else if (myGuide->getTaskID() == "getJobDetails")
-    {
-        emit haveJobDetails(replyState, RemoteJobData::nil());
-    }
-    else if (myGuide->getTaskID() == "stopJob")
-    {
-        emit haveStoppedJob(replyState);
-    }
-    else if (myGuide->getTaskID() == "deleteJob")
-    {
-        emit haveDeletedJob(replyState);
-    }
-    else if (myGuide->getTaskID() == "haveAgaveAppList")
-    {
-        emit haveAgaveAppList(replyState, QVariantList());
-    }
-    else
-    {
-        emit haveJobReply(replyState, QJsonDocument());
-    }
-
+    static_assert(sizeof(kindHandlerTable) / sizeof(kindHandlerTable[0]) == static_cast<size_t>(AgaveTaskKind::KIND_COUNT),
+                  "kindHandlerTable needs one entry per AgaveTaskKind");
+    (this->*(kindHandlerTable[static_cast<int>(myGuide->getTaskKind())].giveEmptyReply))(replyState);
 }
 
 void AgaveTaskReply::rawNoDataNoHttpTaskComplete(RequestState replyState)
 {
+    if (requestEnded) return;
     this->deleteLater();
 
     if (myGuide->getRequestType() != AgaveRequestType::AGAVE_NONE)
@@ -225,9 +283,39 @@ void AgaveTaskReply::rawNoDataNoHttpTaskComplete(RequestState replyState)
     rawPassThruTaskComplete();
 }
 
+void AgaveTaskReply::rawUploadProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    if ((bytesTotal <= 0) || (bytesSent < bytesTotal)) return;
+    if (myReplyObject == nullptr) return;
+
+    //Once the whole body is sent, the in-memory payload is released rather than held until the reply is done
+    QBuffer * pipedData = myReplyObject->findChild<QBuffer *>();
+    if (pipedData != nullptr)
+    {
+        pipedData->close();
+        pipedData->setData(QByteArray());
+    }
+    QObject::disconnect(myReplyObject, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(rawUploadProgress(qint64,qint64)));
+}
+
+void AgaveTaskReply::rawSegmentedDownloadComplete(RequestState finalState)
+{
+    if (!endRequest()) return;
+
+    warnIfUnconnected();
+
+    if (finalState != RequestState::GOOD)
+    {
+        processDatalessReply(finalState);
+        return;
+    }
+
+    emit haveDownloadReply(RequestState::GOOD, taskParamList.value("localDest"));
+}
+
 void AgaveTaskReply::rawPassThruTaskComplete()
 {
-    this->deleteLater();
+    if (!endRequest()) return;
 
     //If this task is an INTERNAL task, then the result is redirected to the manager
     if (myGuide->isInternal())
@@ -236,13 +324,15 @@ void AgaveTaskReply::rawPassThruTaskComplete()
         return;
     }
 
-    signalConnectDelay();
+    warnIfUnconnected();
     processDatalessReply(pendingReply);
 }
 
 void AgaveTaskReply::rawHttpTaskComplete()
 {
-    this->deleteLater();
+    if (replayAfterUnauthorized()) return;
+    if (retryAfterFailure()) return;
+    if (!endRequest()) return;
 
     //If this task is an INTERNAL task, then the result is redirected to the manager
     if (myGuide->isInternal())
@@ -251,7 +341,7 @@ void AgaveTaskReply::rawHttpTaskComplete()
         return;
     }
 
-    signalConnectDelay();
+    warnIfUnconnected();
 
     if (myReplyObject == nullptr)
     {
@@ -260,7 +350,7 @@ void AgaveTaskReply::rawHttpTaskComplete()
         return;
     }
 
-    if (myGuide->getTaskID() != "authRevoke")
+    if (myGuide->getTaskKind() != AgaveTaskKind::AUTH_REVOKE)
     {
         if ((myManager->getInterfaceState() == RemoteDataInterfaceState::DISCONNECTING) ||
                 (myManager->getInterfaceState() == RemoteDataInterfaceState::DISCONNECTED))
@@ -278,68 +368,103 @@ void AgaveTaskReply::rawHttpTaskComplete()
         return;
     }    
 
-    if (testReply->error() != QNetworkReply::NoError)
+    if (downloadLocalFail)
     {
-        if (testReply->error() == 403)
-        {
-            processDatalessReply(RequestState::SERVICE_UNAVAILABLE);
-        }
-        else if (testReply->error() == 401)
-        {
-            processDatalessReply(RequestState::REMOTE_SERVER_ERROR);
-        }
-        else if (testReply->error() == 3)
+        processDatalessReply(RequestState::LOCAL_FILE_ERROR);
+        return;
+    }
+
+    if ((testReply->error() != QNetworkReply::NoError) && (downloadTarget != nullptr))
+    {
+        //A partial file is kept after a transient failure, so that retrying costs only the missing bytes
+        if (isTransientNetworkError(testReply->error()))
         {
-            processDatalessReply(RequestState::LOST_INTERNET);
+            downloadTarget->suspend();
         }
-        else if (testReply->error() == 2)
+        else
         {
-            processDatalessReply(RequestState::DROPPED_CONNECTION);
+            downloadTarget->discard();
         }
-        else if (testReply->error() == 203)
+    }
+
+    if (testReply->error() != QNetworkReply::NoError)
+    {
+        processDatalessReply(interpretNetworkError(testReply));
+        return;
+    }
+
+    if (myGuide->getRequestType() == AgaveRequestType::AGAVE_SINK_DOWNLOAD)
+    {
+        rawSinkDataReady();
+        if (downloadLocalFail)
         {
-            processDatalessReply(RequestState::FILE_NOT_FOUND);
+            processDatalessReply(RequestState::LOCAL_FILE_ERROR);
+            return;
         }
-        else if (testReply->error() == 299)
+
+        emit haveDownloadReply(RequestState::GOOD, QString());
+        return;
+    }
+
+    if (myGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD)
+    {
+        //Flush whatever is still buffered in the reply, then move the file into place
+        rawDownloadDataReady();
+        if (!prepareDownloadTarget() || !downloadTarget->commit())
         {
-            processDatalessReply(RequestState::JOB_SYSTEM_DOWN);
+            processDatalessReply(RequestState::LOCAL_FILE_ERROR);
+            return;
         }
-        else if (testReply->error() == 302)
+
+        emit haveDownloadReply(RequestState::GOOD, taskParamList.value("localDest"));
+        return;
+    }
+
+    QByteArray replyText = readReplyBody();
+
+    QString cacheKey = myReplyObject->property("cacheKey").toString();
+    if (!cacheKey.isEmpty())
+    {
+        if (myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
         {
-            processDatalessReply(RequestState::BAD_HTTP_REQUEST);
+            if (!myManager->responseCache.hasEntry(cacheKey))
+            {
+                processDatalessReply(RequestState::MISSING_REPLY_DATA);
+                return;
+            }
+            myManager->responseCache.refreshEntry(cacheKey);
+            replyText = myManager->responseCache.getBody(cacheKey);
         }
-        else
+        else if ((myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200)
+                 && (!myGuide->isCachedByETagOnly() || !myReplyObject->rawHeader("ETag").isEmpty()))
         {
-            processDatalessReply(RequestState::GENERIC_NETWORK_ERROR);
-
-            qCDebug(remoteInterface, "Network Error detected: %d : %s", testReply->error(), qPrintable(testReply->errorString()));
+            myManager->responseCache.storeEntry(cacheKey, replyText,
+                                                myReplyObject->rawHeader("ETag"), myReplyObject->rawHeader("Last-Modified"));
         }
-        return;
     }
 
-    QByteArray replyText = myReplyObject->readAll();
-
-    if (myGuide->getRequestType() == AgaveRequestType::AGAVE_DOWNLOAD)
+    if (myGuide->getTaskKind() == AgaveTaskKind::RANGE_DOWNLOAD)
     {
-        //TODO: consider a better way of doing this for larger files
-        QFile * fileHandle = new QFile(taskParamList.value("localDest"));
-        if (!fileHandle->open(QIODevice::WriteOnly))
+        //Anything but a partial reply is stopped in rawRangeMetaDataReady, this only catches a reply without headers
+        if (myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
         {
-            fileHandle->deleteLater();
-            processDatalessReply(RequestState::LOCAL_FILE_ERROR);
+            processDatalessReply(RequestState::NOT_IMPLEMENTED);
             return;
         }
 
-        fileHandle->write(replyText);
-        //TODO: There may be more errors here we need to catch
-
-        fileHandle->close();
-        fileHandle->deleteLater();
+        qint64 replyOffset = 0;
+        qint64 totalSize = -1;
+        if (!parseContentRange(myReplyObject->rawHeader("Content-Range"), &replyOffset, &totalSize))
+        {
+            processDatalessReply(RequestState::MISSING_REPLY_DATA);
+            return;
+        }
 
-        emit haveDownloadReply(RequestState::GOOD, taskParamList.value("localDest"));
+        emit haveBufferRangeReply(RequestState::GOOD, replyOffset, replyText);
         return;
     }
-    else if (myGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD)
+
+    if (myGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_DOWNLOAD)
     {
         //TODO: consider a better way of doing this for larger files
         emit haveBufferDownloadReply(RequestState::GOOD, replyText);
@@ -347,6 +472,19 @@ void AgaveTaskReply::rawHttpTaskComplete()
         return;
     }
 
+    processJSONReply(replyText);
+}
+
+void AgaveTaskReply::rawCachedTaskComplete()
+{
+    if (!endRequest()) return;
+
+    warnIfUnconnected();
+    processJSONReply(cachedReplyBody);
+}
+
+void AgaveTaskReply::processJSONReply(QByteArray replyText)
+{
     QJsonParseError parseError;
     QJsonDocument parseHandler = QJsonDocument::fromJson(replyText, &parseError);
 
@@ -366,129 +504,578 @@ void AgaveTaskReply::rawHttpTaskComplete()
         return;
     }
 
-    if (myGuide->getTaskID() == "authRefresh")
+    (this->*(kindHandlerTable[static_cast<int>(myGuide->getTaskKind())].giveParsedReply))(&parseHandler);
+}
+
+void AgaveTaskReply::emptyAuthReply(RequestState replyState)
+{
+    emit haveAuthReply(replyState);
+}
+
+void AgaveTaskReply::emptyRefreshReply(RequestState)
+{
+    //Token refreshes are internal, so this should not be reached
+    qCDebug(remoteInterface, "ERROR: Auth refresh failure given to reply");
+}
+
+void AgaveTaskReply::emptyLogoutReply(RequestState replyState)
+{
+    emit startedLogout(replyState);
+}
+
+void AgaveTaskReply::emptyLSReply(RequestState replyState)
+{
+    emit haveLSReply(replyState, QList<FileMetaData>());
+}
+
+void AgaveTaskReply::emptyUploadReply(RequestState replyState)
+{
+    emit haveUploadReply(replyState, FileMetaData());
+}
+
+void AgaveTaskReply::emptyDeleteReply(RequestState replyState)
+{
+    emit haveDeleteReply(replyState, QString());
+}
+
+void AgaveTaskReply::emptyMkdirReply(RequestState replyState)
+{
+    emit haveMkdirReply(replyState, FileMetaData());
+}
+
+void AgaveTaskReply::emptyRenameReply(RequestState replyState)
+{
+    emit haveRenameReply(replyState, FileMetaData(), QString());
+}
+
+void AgaveTaskReply::emptyMoveReply(RequestState replyState)
+{
+    emit haveMoveReply(replyState, FileMetaData(), QString());
+}
+
+void AgaveTaskReply::emptyCopyReply(RequestState replyState)
+{
+    emit haveCopyReply(replyState,FileMetaData());
+}
+
+void AgaveTaskReply::emptyDownloadReply(RequestState replyState)
+{
+    emit haveDownloadReply(replyState, QString());
+}
+
+void AgaveTaskReply::emptyBufferReply(RequestState replyState)
+{
+    emit haveBufferDownloadReply(replyState, nullptr);
+}
+
+void AgaveTaskReply::emptyRangeReply(RequestState replyState)
+{
+    emit haveBufferRangeReply(replyState, 0, QByteArray());
+}
+
+void AgaveTaskReply::emptyJobReply(RequestState replyState)
+{
+    emit haveJobReply(replyState, QJsonDocument());
+}
+
+void AgaveTaskReply::emptyJobListReply(RequestState replyState)
+{
+    emit haveJobList(replyState, QList<RemoteJobData>());
+}
+
+void AgaveTaskReply::emptyJobDetailsReply(RequestState replyState)
+{
+    emit haveJobDetails(replyState, RemoteJobData::nil());
+}
+
+void AgaveTaskReply::emptyStopJobReply(RequestState replyState)
+{
+    emit haveStoppedJob(replyState);
+}
+
+void AgaveTaskReply::emptyDeleteJobReply(RequestState replyState)
+{
+    emit haveDeletedJob(replyState);
+}
+
+void AgaveTaskReply::emptyAppListReply(RequestState replyState)
+{
+    emit haveAgaveAppList(replyState, QVariantList());
+}
+
+void AgaveTaskReply::parsedRefreshReply(QJsonDocument *)
+{
+    processDatalessReply(RequestState::NOT_IMPLEMENTED);
+}
+
+void AgaveTaskReply::parsedLSReply(QJsonDocument * parsedDoc)
+{
+    QJsonValue expectedArray = retriveMainAgaveJSON(parsedDoc,"result");
+    if (!expectedArray.isArray())
     {
-        processDatalessReply(RequestState::NOT_IMPLEMENTED);
+        processDatalessReply(RequestState::MISSING_REPLY_DATA);
+        return;
     }
-    else if (myGuide->getTaskID() == "dirListing")
+    QJsonArray fileArray = expectedArray.toArray();
+    QList<FileMetaData> fileList;
+    for (auto itr = fileArray.constBegin(); itr != fileArray.constEnd(); itr++)
     {
-        QJsonValue expectedArray = retriveMainAgaveJSON(&parseHandler,"result");
-        if (!expectedArray.isArray())
+        FileMetaData aFile = parseJSONfileMetaData((*itr).toObject());
+        if (aFile.getFileType() == FileType::INVALID)
         {
             processDatalessReply(RequestState::MISSING_REPLY_DATA);
             return;
         }
-        QJsonArray fileArray = expectedArray.toArray();
-        QList<FileMetaData> fileList;
-        for (auto itr = fileArray.constBegin(); itr != fileArray.constEnd(); itr++)
-        {
-            FileMetaData aFile = parseJSONfileMetaData((*itr).toObject());
-            if (aFile.getFileType() == FileType::INVALID)
-            {
-                processDatalessReply(RequestState::MISSING_REPLY_DATA);
-                return;
-            }
-            fileList.append(aFile);
-        }
-        emit haveLSReply(RequestState::GOOD, fileList);
+        fileList.append(aFile);
     }
-    else if ((myGuide->getTaskID() == "fileUpload") || (myGuide->getTaskID() == "filePipeUpload"))
+    emit haveLSReply(RequestState::GOOD, fileList);
+}
+
+bool AgaveTaskReply::parseResultFile(QJsonDocument * parsedDoc, FileMetaData * fileData)
+{
+    QJsonValue expectedObject = retriveMainAgaveJSON(parsedDoc,"result");
+    *fileData = parseJSONfileMetaData(expectedObject.toObject());
+    if (fileData->getFileType() == FileType::INVALID)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        FileMetaData aFile = parseJSONfileMetaData(expectedObject.toObject());
-        if (aFile.getFileType() == FileType::INVALID)
-        {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
-            return;
-        }
-        emit haveUploadReply(RequestState::GOOD, aFile);
+        processDatalessReply(RequestState::MISSING_REPLY_DATA);
+        return false;
+    }
+    return true;
+}
+
+void AgaveTaskReply::parsedUploadReply(QJsonDocument * parsedDoc)
+{
+    FileMetaData aFile;
+    if (!parseResultFile(parsedDoc, &aFile)) return;
+    emit haveUploadReply(RequestState::GOOD, aFile);
+}
+
+void AgaveTaskReply::parsedDeleteReply(QJsonDocument *)
+{
+    emit haveDeleteReply(RequestState::GOOD, taskParamList.value("toDelete"));
+}
+
+void AgaveTaskReply::parsedMkdirReply(QJsonDocument * parsedDoc)
+{
+    FileMetaData aFile;
+    if (!parseResultFile(parsedDoc, &aFile)) return;
+    emit haveMkdirReply(RequestState::GOOD, aFile);
+}
+
+void AgaveTaskReply::parsedRenameReply(QJsonDocument * parsedDoc)
+{
+    FileMetaData aFile;
+    if (!parseResultFile(parsedDoc, &aFile)) return;
+    emit haveRenameReply(RequestState::GOOD, aFile, taskParamList.value("fullName"));
+}
+
+void AgaveTaskReply::parsedMoveReply(QJsonDocument * parsedDoc)
+{
+    FileMetaData aFile;
+    if (!parseResultFile(parsedDoc, &aFile)) return;
+    emit haveMoveReply(RequestState::GOOD, aFile, taskParamList.value("from"));
+}
+
+void AgaveTaskReply::parsedCopyReply(QJsonDocument * parsedDoc)
+{
+    FileMetaData aFile;
+    if (!parseResultFile(parsedDoc, &aFile)) return;
+    emit haveCopyReply(RequestState::GOOD, aFile);
+}
+
+void AgaveTaskReply::parsedJobReply(QJsonDocument * parsedDoc)
+{
+    emit haveJobReply(RequestState::GOOD, *parsedDoc);
+}
+
+void AgaveTaskReply::parsedJobListReply(QJsonDocument * parsedDoc)
+{
+    QJsonValue expectedObject = retriveMainAgaveJSON(parsedDoc,"result");
+    QList<RemoteJobData> jobList = parseJSONjobMetaData(expectedObject.toArray());
+
+    emit haveJobList(RequestState::GOOD, jobList);
+}
+
+void AgaveTaskReply::parsedJobDetailsReply(QJsonDocument * parsedDoc)
+{
+    QJsonValue expectedObject = retriveMainAgaveJSON(parsedDoc,"result");
+    RemoteJobData jobData = parseJSONjobDetails(expectedObject.toObject());
+    if (jobData.getState() == "ERROR")
+    {
+        processDatalessReply(RequestState::MISSING_REPLY_DATA);
+        return;
     }
-    else if (myGuide->getTaskID() == "fileDelete")
+    emit haveJobDetails(RequestState::GOOD, jobData);
+}
+
+void AgaveTaskReply::parsedStopJobReply(QJsonDocument *)
+{
+    emit haveStoppedJob(RequestState::GOOD);
+}
+
+void AgaveTaskReply::parsedDeleteJobReply(QJsonDocument *)
+{
+    emit haveDeletedJob(RequestState::GOOD);
+}
+
+void AgaveTaskReply::parsedAppListReply(QJsonDocument * parsedDoc)
+{
+    //TODO More error checking here
+    QJsonValue expectedArray = retriveMainAgaveJSON(parsedDoc,"result");
+    QJsonArray appList = expectedArray.toArray();
+    emit haveAgaveAppList(RequestState::GOOD, appList.toVariantList());
+}
+
+void AgaveTaskReply::rawDownloadMetaDataReady()
+{
+    if (!downloadBodyExpected()) return;
+    prepareDownloadTarget();
+}
+
+void AgaveTaskReply::rawRangeMetaDataReady()
+{
+    if (!downloadBodyExpected()) return;
+    if (myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206) return;
+
+    //A server that ignores the range sends the whole file with a 200, which is stopped before any of it is buffered
+    qCDebug(remoteInterface, "Range request answered with whole file, stopped: %s", qPrintable(myGuide->getTaskID()));
+    QObject::disconnect(myReplyObject, nullptr, this, nullptr);
+    if ((myReplyObject->property("replyUsers").toInt() <= 1) && myReplyObject->isRunning())
     {
-        emit haveDeleteReply(RequestState::GOOD, taskParamList.value("toDelete"));
+        myReplyObject->abort();
     }
-    else if (myGuide->getTaskID() == "newFolder")
+    detachNetworkReply();
+
+    giveFailedReply(RequestState::NOT_IMPLEMENTED);
+}
+
+void AgaveTaskReply::rawDownloadDataReady()
+{
+    if (!downloadBodyExpected()) return;
+    if (!prepareDownloadTarget()) return;
+
+    //The reply's read buffer is capped in AgaveHandler::finalizeAgaveRequest,
+    //so each pass here moves at most that much from memory to disk
+    while (myReplyObject->bytesAvailable() > 0)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        FileMetaData aFile = parseJSONfileMetaData(expectedObject.toObject());
-        if (aFile.getFileType() == FileType::INVALID)
+        if (!downloadTarget->append(myReplyObject->read(myReplyObject->bytesAvailable())))
         {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
+            failDownloadTarget();
             return;
         }
-        emit haveMkdirReply(RequestState::GOOD, aFile);
     }
-    else if (myGuide->getTaskID() == "renameFile")
+}
+
+void AgaveTaskReply::rawSinkDataReady()
+{
+    if (downloadLocalFail) return;
+    if (!downloadBodyExpected()) return;
+
+    while (myReplyObject->bytesAvailable() > 0)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        FileMetaData aFile = parseJSONfileMetaData(expectedObject.toObject());
-        if (aFile.getFileType() == FileType::INVALID)
+        QByteArray chunk = myReplyObject->read(myReplyObject->bytesAvailable());
+
+        if (hasDownloadSink && ((downloadSink == nullptr) || (downloadSink->write(chunk) != chunk.size())))
         {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
+            qCDebug(remoteInterface, "ERROR: Unable to write download to device.");
+            failDownloadTarget();
             return;
         }
-        emit haveRenameReply(RequestState::GOOD, aFile, taskParamList.value("fullName"));
+
+        emit haveDownloadChunk(sinkOffset, chunk);
+        sinkOffset += chunk.size();
+    }
+}
+
+QByteArray AgaveTaskReply::readReplyBody()
+{
+    //Coalesced requests share one QNetworkReply, so the first reader keeps the body for the rest
+    QVariant sharedBody = myReplyObject->property("sharedReplyBody");
+    if (sharedBody.isValid())
+    {
+        return sharedBody.toByteArray();
     }
-    else if (myGuide->getTaskID() == "fileCopy")
+
+    QByteArray ret = myReplyObject->readAll();
+    if (myReplyObject->property("replyUsers").toInt() > 1)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        FileMetaData aFile = parseJSONfileMetaData(expectedObject.toObject());
-        if (aFile.getFileType() == FileType::INVALID)
+        myReplyObject->setProperty("sharedReplyBody", ret);
+    }
+    return ret;
+}
+
+bool AgaveTaskReply::downloadBodyExpected()
+{
+    if (myReplyObject == nullptr) return false;
+    if (myReplyObject->error() != QNetworkReply::NoError) return false;
+
+    //Error pages and redirects are not file contents
+    QVariant statusCode = myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (!statusCode.isValid()) return false;
+    return ((statusCode.toInt() >= 200) && (statusCode.toInt() < 300));
+}
+
+bool AgaveTaskReply::prepareDownloadTarget()
+{
+    if (downloadLocalFail) return false;
+
+    if (downloadTarget == nullptr)
+    {
+        downloadTarget = new AgaveDownloadTarget(taskParamList.value("localDest"));
+    }
+    if (downloadTarget->isOpen()) return true;
+
+    qint64 startOffset = 0;
+    qint64 totalSize = -1;
+
+    if (myReplyObject->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206)
+    {
+        //A partial reply must pick up exactly where our partial file left off
+        if (!parseContentRange(myReplyObject->rawHeader("Content-Range"), &startOffset, &totalSize)
+                || (startOffset != taskParamList.value("resumeOffset").toLongLong()))
         {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
-            return;
+            qCDebug(remoteInterface, "ERROR: Resumed download does not line up with partial file.");
+            failDownloadTarget();
+            return false;
+        }
+
+        //A different size means a different file, even if its stamp matched; the partial file is dropped so the next try starts over
+        qint64 resumeSize = taskParamList.value("resumeSize", "-1").toLongLong();
+        if ((resumeSize >= 0) && (totalSize != resumeSize))
+        {
+            qCDebug(remoteInterface, "ERROR: Remote file size changed since the partial download: %lld, was %lld", totalSize, resumeSize);
+            failDownloadTarget();
+            return false;
         }
-        emit haveCopyReply(RequestState::GOOD, aFile);
     }
-    else if (myGuide->getTaskID() == "fileMove")
+    else
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        FileMetaData aFile = parseJSONfileMetaData(expectedObject.toObject());
-        if (aFile.getFileType() == FileType::INVALID)
+        //Either a fresh download, or the remote file changed and the server sent all of it
+        QVariant contentLength = myReplyObject->header(QNetworkRequest::ContentLengthHeader);
+        if (contentLength.isValid())
         {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
-            return;
+            totalSize = contentLength.toLongLong();
         }
-        emit haveMoveReply(RequestState::GOOD, aFile, taskParamList.value("from"));
     }
-    else if (myGuide->getTaskID() == "getJobList")
+
+    if (!downloadTarget->open(startOffset))
+    {
+        failDownloadTarget();
+        return false;
+    }
+    downloadTarget->setRemoteInfo(taskParamList.value("remoteName"), totalSize, myReplyObject->rawHeader("Last-Modified"));
+    if (totalSize > 0)
+    {
+        downloadTarget->preallocate(totalSize);
+    }
+    return true;
+}
+
+void AgaveTaskReply::cancel()
+{
+    if (QThread::currentThread() != this->thread())
+    {
+        //The reply is given later, from this reply's own thread
+        QMetaObject::invokeMethod(this, "cancel", Qt::QueuedConnection);
+        return;
+    }
+
+    if (requestEnded) return;
+
+    //A segmented download stops its own range requests, then reports back through rawSegmentedDownloadComplete
+    AgaveSegmentedDownload * segmentEngine = findChild<AgaveSegmentedDownload *>(QString(), Qt::FindDirectChildrenOnly);
+    if (segmentEngine != nullptr)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        QList<RemoteJobData> jobList = parseJSONjobMetaData(expectedObject.toArray());
+        segmentEngine->cancel();
+        return;
+    }
 
-        emit haveJobList(RequestState::GOOD, jobList);
+    //Internal steps of a chained request, such as login, end this one through forwardReplyToParent
+    for (AgaveTaskReply * childReply : findChildren<AgaveTaskReply *>(QString(), Qt::FindDirectChildrenOnly))
+    {
+        childReply->cancel();
     }
-    else if (myGuide->getTaskID() == "getJobDetails")
+    if (requestEnded) return;
+
+    if (myReplyObject != nullptr)
     {
-        QJsonValue expectedObject = retriveMainAgaveJSON(&parseHandler,"result");
-        RemoteJobData jobData = parseJSONjobDetails(expectedObject.toObject());
-        if (jobData.getState() == "ERROR")
+        //A coalesced reply is only stopped by its last user
+        QObject::disconnect(myReplyObject, nullptr, this, nullptr);
+        if ((myReplyObject->property("replyUsers").toInt() <= 1) && myReplyObject->isRunning())
         {
-            processDatalessReply(RequestState::MISSING_REPLY_DATA);
-            return;
+            myReplyObject->abort();
         }
-        emit haveJobDetails(RequestState::GOOD, jobData);
+        detachNetworkReply();
     }
-    else if (myGuide->getTaskID() == "stopJob")
+
+    if (downloadTarget != nullptr)
     {
-        emit haveStoppedJob(RequestState::GOOD);
+        downloadTarget->discard();
     }
-    else if (myGuide->getTaskID() == "deleteJob")
+
+    if (!endRequest()) return;
+    qCDebug(remoteInterface, "Request cancelled: %s", qPrintable(myGuide->getTaskID()));
+
+    if (myGuide->isInternal())
     {
-        emit haveDeletedJob(RequestState::GOOD);
+        myManager->handleInternalTask(this, RequestState::STOPPED_BY_USER);
+        return;
     }
-    else if (myGuide->getTaskID() == "getAgaveList")
+    processDatalessReply(RequestState::STOPPED_BY_USER);
+}
+
+bool AgaveTaskReply::endRequest()
+{
+    //A cancelled request has already given its reply
+    if (requestEnded) return false;
+    requestEnded = true;
+
+    this->deleteLater();
+    return true;
+}
+
+void AgaveTaskReply::giveFailedReply(RequestState replyState)
+{
+    if (!endRequest()) return;
+    processDatalessReply(replyState);
+}
+
+bool AgaveTaskReply::replayAfterUnauthorized()
+{
+    QNetworkReply * testReply = qobject_cast<QNetworkReply *>(sender());
+    if ((testReply == nullptr) || (testReply != myReplyObject)) return false;
+    if (testReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 401) return false;
+
+    if (myGuide->isInternal() || (myGuide->getHeaderType() != AuthHeaderType::TOKEN)) return false;
+    //A second refusal, with a fresh token, is a real one
+    if (tokenReplayed) return false;
+    //Data already taken from a pipe or stream cannot be sent again
+    if ((myGuide->getRequestType() == AgaveRequestType::AGAVE_PIPE_UPLOAD)
+            || (myGuide->getRequestType() == AgaveRequestType::AGAVE_STREAM_UPLOAD)) return false;
+    if (hasDownloadSink && (sinkOffset > 0)) return false;
+    if (myManager->getInterfaceState() != RemoteDataInterfaceState::CONNECTED) return false;
+
+    tokenReplayed = true;
+    qCDebug(remoteInterface, "Access token refused for %s, replaying after refresh", qPrintable(myGuide->getTaskID()));
+
+    if (downloadTarget != nullptr)
     {
-        //TODO More error checking here
-        QJsonValue expectedArray = retriveMainAgaveJSON(&parseHandler,"result");
-        QJsonArray appList = expectedArray.toArray();
-        emit haveAgaveAppList(RequestState::GOOD, appList.toVariantList());
+        delete downloadTarget;
+        downloadTarget = nullptr;
     }
-    else
+    detachNetworkReply();
+
+    myManager->replayAfterTokenRefresh(this);
+    return true;
+}
+
+bool AgaveTaskReply::retryAfterFailure()
+{
+    QNetworkReply * testReply = qobject_cast<QNetworkReply *>(sender());
+    if ((testReply == nullptr) || (testReply != myReplyObject)) return false;
+    if (testReply->error() == QNetworkReply::NoError) return false;
+    if (testReply->property("timedOut").toBool()) return false;
+
+    if (myGuide->isInternal() || !myGuide->isRetryable()) return false;
+    if (downloadLocalFail) return false;
+    //Bytes already handed to a sink cannot be taken back
+    if (hasDownloadSink && (sinkOffset > 0)) return false;
+    if (myManager->getInterfaceState() != RemoteDataInterfaceState::CONNECTED) return false;
+
+    qint64 retryDelay = myManager->retryPolicy.takeRetryDelay(testReply, retryCount);
+    if (retryDelay < 0) return false;
+
+    retryCount++;
+    qCDebug(remoteInterface, "Retrying %s in %lld ms: %s", qPrintable(myGuide->getTaskID()), retryDelay, qPrintable(testReply->errorString()));
+
+    if (downloadTarget != nullptr)
+    {
+        //The partial file is kept, and the next attempt resumes from it
+        delete downloadTarget;
+        downloadTarget = nullptr;
+    }
+    detachNetworkReply();
+
+    QTimer::singleShot(static_cast<int>(retryDelay), this, SLOT(resendRequest()));
+    return true;
+}
+
+void AgaveTaskReply::resendRequest()
+{
+    if (requestEnded) return;
+    myManager->requestScheduler->enqueueRequest(this);
+}
+
+RequestState AgaveTaskReply::interpretNetworkError(QNetworkReply * failedReply)
+{
+    if (failedReply->property("timedOut").toBool())
+    {
+        return RequestState::TIMED_OUT;
+    }
+    if (failedReply->error() == 403)
+    {
+        return RequestState::SERVICE_UNAVAILABLE;
+    }
+    else if (failedReply->error() == 401)
+    {
+        return RequestState::REMOTE_SERVER_ERROR;
+    }
+    else if (failedReply->error() == 3)
+    {
+        return RequestState::LOST_INTERNET;
+    }
+    else if (failedReply->error() == 2)
+    {
+        return RequestState::DROPPED_CONNECTION;
+    }
+    else if (failedReply->error() == 203)
+    {
+        return RequestState::FILE_NOT_FOUND;
+    }
+    else if (failedReply->error() == 299)
+    {
+        return RequestState::JOB_SYSTEM_DOWN;
+    }
+    else if (failedReply->error() == 302)
+    {
+        return RequestState::BAD_HTTP_REQUEST;
+    }
+
+    qCDebug(remoteInterface, "Network Error detected: %d : %s", failedReply->error(), qPrintable(failedReply->errorString()));
+    return RequestState::GENERIC_NETWORK_ERROR;
+}
+
+bool AgaveTaskReply::isTransientNetworkError(QNetworkReply::NetworkError errorCode)
+{
+    switch (errorCode)
+    {
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::ServiceUnavailableError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void AgaveTaskReply::failDownloadTarget()
+{
+    downloadLocalFail = true;
+    if (downloadTarget != nullptr)
     {
-        emit haveJobReply(RequestState::GOOD, parseHandler);
+        downloadTarget->discard();
     }
 
+    //Nothing more can be written locally, so stop the transfer
+    if ((myReplyObject != nullptr) && myReplyObject->isRunning())
+    {
+        myReplyObject->abort();
+    }
 }
 
 RequestState AgaveTaskReply::standardSuccessFailCheck(AgaveTaskGuide * taskGuide, QJsonDocument * parsedDoc)
@@ -605,6 +1192,29 @@ RemoteJobData AgaveTaskReply::parseJSONjobDetails(QJsonObject rawJobData, bool h
     return ret;
 }
 
+bool AgaveTaskReply::parseContentRange(QByteArray rangeHeader, qint64 * rangeStart, qint64 * totalSize)
+{
+    //Content-Range: bytes START-END/TOTAL, where TOTAL may be *
+    QByteArray rangeText = rangeHeader.trimmed();
+    if (!rangeText.startsWith("bytes ")) return false;
+    rangeText = rangeText.mid(6);
+
+    int dashPos = rangeText.indexOf('-');
+    int slashPos = rangeText.indexOf('/');
+    if ((dashPos <= 0) || (slashPos <= dashPos)) return false;
+
+    bool convOkay;
+    qint64 startVal = rangeText.left(dashPos).toLongLong(&convOkay);
+    if (!convOkay) return false;
+
+    qint64 totalVal = rangeText.mid(slashPos + 1).toLongLong(&convOkay);
+    if (!convOkay) totalVal = -1;
+
+    if (rangeStart != nullptr) *rangeStart = startVal;
+    if (totalSize != nullptr) *totalSize = totalVal;
+    return true;
+}
+
 QJsonValue AgaveTaskReply::retriveMainAgaveJSON(QJsonDocument * parsedDoc, const char * oneKey)
 {
     QList<QString> smallList = { oneKey };
@@ -714,22 +1324,15 @@ QMap<QString, QString> AgaveTaskReply::convertVarMapToString(QMap<QString, QVari
     return ret;
 }
 
-void AgaveTaskReply::signalConnectDelay()
+void AgaveTaskReply::warnIfUnconnected()
 {
     if (!expectsSignalConnect) return;
 
-    //This method is a stopgap against a reply object finishing before
-    //being connected to anything. This should never happen.
-    int failTrys = 0;
-    while (!anySignalConnect())
+    //Replies are only ever given from the event loop, after the call making the request has
+    //returned, so a caller following the contract in RemoteDataReply is always connected by now
+    if (!anySignalConnect())
     {
-        failTrys++;
-        if (failTrys > 10)
-        {
-            qCDebug(remoteInterface, "ERROR: Reply object finished before/without connection to rest of program.");
-            return;
-        }
-        QThread::usleep(10);
+        qCDebug(remoteInterface, "ERROR: Reply object finished before/without connection to rest of program.");
     }
 }
 
@@ -750,6 +1353,8 @@ bool AgaveTaskReply::anySignalConnect()
     if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveUploadReply))) return true;
     if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveDownloadReply))) return true;
     if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveBufferDownloadReply))) return true;
+    if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveBufferRangeReply))) return true;
+    if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveDownloadChunk))) return true;
 
     if (isSignalConnected(QMetaMethod::fromSignal(&AgaveTaskReply::haveJobReply))) return true;
 
@@ -41,11 +41,13 @@
 #include <QNetworkReply>
 
 #include <QTimer>
+#include <QPointer>
 #include <QMetaMethod>
 #include <QJsonArray>
 
 class AgaveHandler;
 class AgaveTaskGuide;
+class AgaveDownloadTarget;
 
 class AgaveTaskReply : public RemoteDataReply
 {
@@ -56,12 +58,30 @@ class AgaveTaskReply : public RemoteDataReply
 public:
     explicit AgaveTaskReply(AgaveTaskGuide * theGuide, QNetworkReply *newReply, AgaveHandler * theManager, QObject *parent = nullptr);
     explicit AgaveTaskReply(AgaveTaskGuide * theGuide, RequestState passThruErrorState, AgaveHandler * theManager, QObject *parent = nullptr);
+    explicit AgaveTaskReply(AgaveTaskGuide * theGuide, AgaveHandler * theManager, QObject *parent = nullptr);
     ~AgaveTaskReply();
 
     virtual void setAsUnconnectedReply();
+    virtual void setRequestPriority(RequestPriority newPriority, QObject * client = nullptr);
+
+    RequestPriority getRequestPriority();
+    QObject * getRequestClient();
+
+public slots:
+    virtual void cancel();
+
+public:
+    static RequestState interpretNetworkError(QNetworkReply * failedReply);
+    static bool isTransientNetworkError(QNetworkReply::NetworkError errorCode);
+    static bool parseContentRange(QByteArray rangeHeader, qint64 * rangeStart, qint64 * totalSize);
 
 protected:
     QMap<QString, QByteArray> *getTaskParamList();
+    void setDownloadSink(QIODevice * sink);
+    void setUploadSource(QIODevice * source);
+    QIODevice * getUploadSource();
+    void attachNetworkReply(QNetworkReply * newReply);
+    void setCachedReply(QByteArray replyBody);
 
     //-------------------------------------------------
     //Agave specific:
@@ -85,21 +105,95 @@ signals:
     //Double-check that the data is all passed.
     void haveAgaveAppList(RequestState theGuide, QVariantList appsList);
 
+    //Emitted by segmented downloads as each byte range completes
+    void haveDownloadSegmentStats(int segmentNum, qint64 segmentBytes, qint64 elapsedMsecs);
+
 protected slots:
     void rawNoDataNoHttpTaskComplete(RequestState replyState = RequestState::GOOD);
 
 private slots:
     void rawPassThruTaskComplete();
     void rawHttpTaskComplete();
+    void rawCachedTaskComplete();
+
+    void rawDownloadMetaDataReady();
+    void rawDownloadDataReady();
+    void rawRangeMetaDataReady();
+
+    void rawSegmentedDownloadComplete(RequestState finalState);
+
+    void rawUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void rawSinkDataReady();
+
+    void resendRequest();
 
 private:
     bool performInitPointerCheck(AgaveTaskGuide * theGuide, AgaveHandler * theManager);
 
-    void signalConnectDelay();
+    void warnIfUnconnected();
     bool anySignalConnect();
 
     void setDelayedDatalessReply(RequestState replyState);
     void processDatalessReply(RequestState replyState);
+    void processJSONReply(QByteArray replyText);
+
+    QByteArray readReplyBody();
+
+    //Giving the result of each AgaveTaskKind, looked up in kindHandlerTable
+    typedef void (AgaveTaskReply::*EmptyReplyHandler)(RequestState replyState);
+    typedef void (AgaveTaskReply::*ParsedReplyHandler)(QJsonDocument * parsedDoc);
+    struct KindHandlers
+    {
+        EmptyReplyHandler giveEmptyReply;
+        ParsedReplyHandler giveParsedReply;
+    };
+    static const KindHandlers kindHandlerTable[];
+
+    void emptyAuthReply(RequestState replyState);
+    void emptyRefreshReply(RequestState replyState);
+    void emptyLogoutReply(RequestState replyState);
+    void emptyLSReply(RequestState replyState);
+    void emptyUploadReply(RequestState replyState);
+    void emptyDeleteReply(RequestState replyState);
+    void emptyMkdirReply(RequestState replyState);
+    void emptyRenameReply(RequestState replyState);
+    void emptyMoveReply(RequestState replyState);
+    void emptyCopyReply(RequestState replyState);
+    void emptyDownloadReply(RequestState replyState);
+    void emptyBufferReply(RequestState replyState);
+    void emptyRangeReply(RequestState replyState);
+    void emptyJobReply(RequestState replyState);
+    void emptyJobListReply(RequestState replyState);
+    void emptyJobDetailsReply(RequestState replyState);
+    void emptyStopJobReply(RequestState replyState);
+    void emptyDeleteJobReply(RequestState replyState);
+    void emptyAppListReply(RequestState replyState);
+
+    bool parseResultFile(QJsonDocument * parsedDoc, FileMetaData * fileData);
+    void parsedRefreshReply(QJsonDocument * parsedDoc);
+    void parsedLSReply(QJsonDocument * parsedDoc);
+    void parsedUploadReply(QJsonDocument * parsedDoc);
+    void parsedDeleteReply(QJsonDocument * parsedDoc);
+    void parsedMkdirReply(QJsonDocument * parsedDoc);
+    void parsedRenameReply(QJsonDocument * parsedDoc);
+    void parsedMoveReply(QJsonDocument * parsedDoc);
+    void parsedCopyReply(QJsonDocument * parsedDoc);
+    void parsedJobReply(QJsonDocument * parsedDoc);
+    void parsedJobListReply(QJsonDocument * parsedDoc);
+    void parsedJobDetailsReply(QJsonDocument * parsedDoc);
+    void parsedStopJobReply(QJsonDocument * parsedDoc);
+    void parsedDeleteJobReply(QJsonDocument * parsedDoc);
+    void parsedAppListReply(QJsonDocument * parsedDoc);
+
+    bool endRequest();
+    void giveFailedReply(RequestState replyState);
+    bool retryAfterFailure();
+    bool replayAfterUnauthorized();
+    void detachNetworkReply();
+
+    bool downloadBodyExpected();
+    bool prepareDownloadTarget();
+    void failDownloadTarget();
 
     AgaveHandler * myManager = nullptr;
     AgaveTaskGuide * myGuide = nullptr;
@@ -110,6 +204,26 @@ private:
     RequestState pendingReply = RequestState::INTERNAL_ERROR;
 
     bool expectsSignalConnect = true;
+    bool requestEnded = false;
+
+    //request scheduling store:
+    RequestPriority requestPriority = RequestPriority::INTERACTIVE;
+    QObject * requestClient = nullptr;
+    QPointer<QIODevice> uploadSource;
+    int retryCount = 0;
+    bool tokenReplayed = false;
+
+    //response cache store:
+    QByteArray cachedReplyBody;
+
+    //streamed file download store:
+    AgaveDownloadTarget * downloadTarget = nullptr;
+    bool downloadLocalFail = false;
+
+    //device download store:
+    QPointer<QIODevice> downloadSink;
+    bool hasDownloadSink = false;
+    qint64 sinkOffset = 0;
 
     QMap<QString, QByteArray> taskParamList;
 };
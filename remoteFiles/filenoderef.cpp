@@ -109,6 +109,26 @@ const QByteArray FileNodeRef::getFileBuffer() const
     return myFileOperator->getFileBuffer(*this);
 }
 
+bool FileNodeRef::fileBufferRangeLoaded(qint64 offset, qint64 length) const
+{
+    if (myFileOperator == nullptr)
+    {
+        if (getFileType() != FileType::NIL) qCDebug(fileManager, "ERROR: attempted use of FileNodeRef without file operator.(12)");
+        return false;
+    }
+    return myFileOperator->fileBufferRangeLoaded(*this, offset, length);
+}
+
+const QByteArray FileNodeRef::getFileBufferRange(qint64 offset, qint64 length) const
+{
+    if (myFileOperator == nullptr)
+    {
+        if (getFileType() != FileType::NIL) qCDebug(fileManager, "ERROR: attempted use of FileNodeRef without file operator.(13)");
+        return QByteArray();
+    }
+    return myFileOperator->getFileBufferRange(*this, offset, length);
+}
+
 void FileNodeRef::setFileBuffer(const QByteArray * toSet) const
 {
     if (myFileOperator == nullptr)
@@ -59,6 +59,8 @@ public:
     const FileNodeRef getChildWithName(QString childName) const;
     bool fileBufferLoaded() const;
     const QByteArray getFileBuffer() const;
+    bool fileBufferRangeLoaded(qint64 offset, qint64 length) const;
+    const QByteArray getFileBufferRange(qint64 offset, qint64 length) const;
     void setFileBuffer(const QByteArray * toSet) const;
     bool folderContentsLoaded() const;
     FileNodeRef getParent() const;
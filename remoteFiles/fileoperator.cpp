@@ -100,6 +100,7 @@ void FileOperator::enactRootRefresh()
     QString rootFolder = "/";
     rootFolder = rootFolder.append(myRootFolderName);
     RemoteDataReply * theReply = myInterface->remoteLS(rootFolder);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     rootFileNode->setLStask(theReply);
 }
@@ -121,6 +122,7 @@ void FileOperator::enactFolderRefresh(const FileNodeRef &selectedNode, bool clea
 
     qCDebug(fileManager, "File Path Needs refresh: %s", qPrintable(fullFilePath));
     RemoteDataReply * theReply = myInterface->remoteLS(fullFilePath);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     trueNode->setLStask(theReply);
 }
@@ -153,6 +155,7 @@ void FileOperator::sendDeleteReq(const FileNodeRef &selectedNode)
     QString targetFile = selectedNode.getFullPath();
     qCDebug(fileManager, "Starting delete procedure: %s",qPrintable(targetFile));
     RemoteDataReply * theReply = myInterface->deleteFile(targetFile);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     QObject::connect(theReply, SIGNAL(haveDeleteReply(RequestState, QString)),
                      this, SLOT(getDeleteReply(RequestState, QString)));
@@ -184,6 +187,7 @@ void FileOperator::sendMoveReq(const FileNodeRef &moveFrom, QString newName)
             qPrintable(moveFrom.getFullPath()),
             qPrintable(newName));
     RemoteDataReply * theReply = myInterface->moveFile(moveFrom.getFullPath(), newName);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     QObject::connect(theReply, SIGNAL(haveMoveReply(RequestState,FileMetaData, QString)),
                      this, SLOT(getMoveReply(RequestState,FileMetaData, QString)));
@@ -218,6 +222,7 @@ void FileOperator::sendCopyReq(const FileNodeRef &copyFrom, QString newName)
            qPrintable(copyFrom.getFullPath()),
            qPrintable(newName));
     RemoteDataReply * theReply = myInterface->copyFile(copyFrom.getFullPath(), newName);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     QObject::connect(theReply, SIGNAL(haveCopyReply(RequestState,FileMetaData)),
                      this, SLOT(getCopyReply(RequestState,FileMetaData)));
@@ -249,6 +254,7 @@ void FileOperator::sendRenameReq(const FileNodeRef &selectedNode, QString newNam
            qPrintable(selectedNode.getFullPath()),
            qPrintable(newName));
     RemoteDataReply * theReply = myInterface->renameFile(selectedNode.getFullPath(), newName);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     QObject::connect(theReply, SIGNAL(haveRenameReply(RequestState,FileMetaData, QString)),
                      this, SLOT(getRenameReply(RequestState,FileMetaData, QString)));
@@ -274,20 +280,22 @@ void FileOperator::getRenameReply(RequestState replyState, FileMetaData newFileD
     }
 }
 
-void FileOperator::sendCreateFolderReq(const FileNodeRef &selectedNode, QString newName)
+RemoteDataReply * FileOperator::sendCreateFolderReq(const FileNodeRef &selectedNode, QString newName)
 {
-    if (myState != FileOperatorState::IDLE) return;
-    if (!selectedNode.fileNodeExtant()) return;
+    if (myState != FileOperatorState::IDLE) return nullptr;
+    if (!selectedNode.fileNodeExtant()) return nullptr;
 
     qCDebug(fileManager,"Starting create folder procedure: %s at %s",
            qPrintable(selectedNode.getFullPath()),
            qPrintable(newName));
     RemoteDataReply * theReply = myInterface->mkRemoteDir(selectedNode.getFullPath(), newName);
+    setReplyPriority(theReply, RequestPriority::INTERACTIVE);
 
     QObject::connect(theReply, SIGNAL(haveMkdirReply(RequestState,FileMetaData)),
                      this, SLOT(getMkdirReply(RequestState,FileMetaData)));
     myState = FileOperatorState::ACTIVE;
     emit fileOpStarted();
+    return theReply;
 }
 
 void FileOperator::getMkdirReply(RequestState replyState, FileMetaData newFolderData)
@@ -311,19 +319,21 @@ void FileOperator::getMkdirReply(RequestState replyState, FileMetaData newFolder
     }
 }
 
-void FileOperator::sendUploadReq(const FileNodeRef &uploadTarget, QString localFile)
+RemoteDataReply * FileOperator::sendUploadReq(const FileNodeRef &uploadTarget, QString localFile)
 {
-    if (myState != FileOperatorState::IDLE) return;
-    if (!uploadTarget.fileNodeExtant()) return;
+    if (myState != FileOperatorState::IDLE) return nullptr;
+    if (!uploadTarget.fileNodeExtant()) return nullptr;
 
     qCDebug(fileManager, "Starting upload procedure: %s to %s", qPrintable(localFile),
            qPrintable(uploadTarget.getFullPath()));
     RemoteDataReply * theReply = myInterface->uploadFile(uploadTarget.getFullPath(), localFile);
+    setReplyPriority(theReply, RequestPriority::BULK);
 
     QObject::connect(theReply, SIGNAL(haveUploadReply(RequestState,FileMetaData)),
                      this, SLOT(getUploadReply(RequestState,FileMetaData)));
     myState = FileOperatorState::ACTIVE;
     emit fileOpStarted();
+    return theReply;
 }
 
 void FileOperator::sendUploadBuffReq(const FileNodeRef &uploadTarget, QByteArray fileBuff, QString newName)
@@ -333,6 +343,7 @@ void FileOperator::sendUploadBuffReq(const FileNodeRef &uploadTarget, QByteArray
 
     qCDebug(fileManager, "Starting upload procedure: to %s", qPrintable(uploadTarget.getFullPath()));
     RemoteDataReply * theReply = myInterface->uploadBuffer(uploadTarget.getFullPath(), fileBuff, newName);
+    setReplyPriority(theReply, RequestPriority::BULK);
 
     QObject::connect(theReply, SIGNAL(haveUploadReply(RequestState,FileMetaData)),
                      this, SLOT(getUploadReply(RequestState,FileMetaData)));
@@ -369,6 +380,7 @@ void FileOperator::sendDownloadReq(const FileNodeRef &targetFile, QString localD
     qCDebug(fileManager, "Starting download procedure: %s to %s", qPrintable(targetFile.getFullPath()),
            qPrintable(localDest));
     RemoteDataReply * theReply = myInterface->downloadFile(localDest, targetFile.getFullPath());
+    setReplyPriority(theReply, RequestPriority::BULK);
 
     QObject::connect(theReply, SIGNAL(haveDownloadReply(RequestState, QString)),
                      this, SLOT(getDownloadReply(RequestState, QString)));
@@ -376,19 +388,45 @@ void FileOperator::sendDownloadReq(const FileNodeRef &targetFile, QString localD
     emit fileOpStarted();
 }
 
-void FileOperator::sendDownloadBuffReq(const FileNodeRef &targetFile)
+RemoteDataReply * FileOperator::sendDownloadBuffReq(const FileNodeRef &targetFile)
 {
-    if (!targetFile.fileNodeExtant()) return;
+    if (!targetFile.fileNodeExtant()) return nullptr;
     FileTreeNode * trueNode = getFileNodeFromNodeRef(targetFile);
     if (trueNode->haveBuffTask())
     {
-        return;
+        return nullptr;
     }
     qCDebug(fileManager, "Starting download buffer procedure: %s", qPrintable(targetFile.getFullPath()));
     RemoteDataReply * theReply = myInterface->downloadBuffer(targetFile.getFullPath());
+    setReplyPriority(theReply, RequestPriority::BACKGROUND);
+    trueNode->setBuffTask(theReply);
+    return theReply;
+}
+
+void FileOperator::sendDownloadBuffReq(const FileNodeRef &targetFile, qint64 offset, qint64 length)
+{
+    if (!targetFile.fileNodeExtant()) return;
+    FileTreeNode * trueNode = getFileNodeFromNodeRef(targetFile);
+    if (trueNode->haveBuffTask())
+    {
+        return;
+    }
+    if (trueNode->bufferRangeLoaded(offset, length))
+    {
+        return;
+    }
+    qCDebug(fileManager, "Starting ranged download buffer procedure: %s (%lld, %lld)", qPrintable(targetFile.getFullPath()), offset, length);
+    RemoteDataReply * theReply = myInterface->downloadBufferRange(targetFile.getFullPath(), offset, length);
+    setReplyPriority(theReply, RequestPriority::BACKGROUND);
     trueNode->setBuffTask(theReply);
 }
 
+void FileOperator::setReplyPriority(RemoteDataReply * theReply, RequestPriority basePriority)
+{
+    if (theReply == nullptr) return;
+    theReply->setRequestPriority(basePriority, this);
+}
+
 FileRecursiveOperator * FileOperator::getRecursiveOp()
 {
     return myRecursiveHandler;
@@ -570,6 +608,20 @@ const QByteArray FileOperator::getFileBuffer(const FileNodeRef &baseFile)
     return *storedArray;
 }
 
+bool FileOperator::fileBufferRangeLoaded(const FileNodeRef &baseFile, qint64 offset, qint64 length)
+{
+    FileTreeNode * baseNode = getFileNodeFromNodeRef(baseFile);
+    if (baseNode == nullptr) return false;
+    return baseNode->bufferRangeLoaded(offset, length);
+}
+
+const QByteArray FileOperator::getFileBufferRange(const FileNodeRef &baseFile, qint64 offset, qint64 length)
+{
+    FileTreeNode * baseNode = getFileNodeFromNodeRef(baseFile);
+    if (baseNode == nullptr) return QByteArray();
+    return baseNode->getBufferRange(offset, length);
+}
+
 void FileOperator::setFileBuffer(const FileNodeRef &theFile, const QByteArray * toSet)
 {
     FileTreeNode * baseNode = getFileNodeFromNodeRef(theFile);
@@ -54,6 +54,7 @@ class RemoteFileTree;
 class FileMetaData;
 class RemoteFileModel;
 class RemoteDataInterface;
+class RemoteDataReply;
 class FileStandardItem;
 class FileRecursiveOperator;
 
@@ -61,6 +62,7 @@ enum class RequestState;
 enum class NodeState;
 enum class FileOperatorState {IDLE, ACTIVE, UNINITIALIZED};
 enum class RemoteDataInterfaceState;
+enum class RequestPriority;
 
 class FileOperator : public QObject
 {
@@ -91,12 +93,14 @@ public:
     void sendCopyReq(const FileNodeRef &copyFrom, QString newName);
     void sendRenameReq(const FileNodeRef &selectedNode, QString newName);
 
-    void sendCreateFolderReq(const FileNodeRef &selectedNode, QString newName);
+    //These give the reply, so a recursive operation can track it, or nullptr if nothing was sent
+    RemoteDataReply * sendCreateFolderReq(const FileNodeRef &selectedNode, QString newName);
 
-    void sendUploadReq(const FileNodeRef &uploadTarget, QString localFile);
+    RemoteDataReply * sendUploadReq(const FileNodeRef &uploadTarget, QString localFile);
     void sendUploadBuffReq(const FileNodeRef &uploadTarget, QByteArray fileBuff, QString newName);
     void sendDownloadReq(const FileNodeRef &targetFile, QString localDest);
-    void sendDownloadBuffReq(const FileNodeRef &targetFile);
+    RemoteDataReply * sendDownloadBuffReq(const FileNodeRef &targetFile);
+    void sendDownloadBuffReq(const FileNodeRef &targetFile, qint64 offset, qint64 length);
 
     FileRecursiveOperator * getRecursiveOp();
 
@@ -116,6 +120,8 @@ protected:
     bool isAncestorOf(const FileNodeRef &parent, const FileNodeRef &child);
     const FileNodeRef getChildWithName(const FileNodeRef &baseFile, QString childName);
     const QByteArray getFileBuffer(const FileNodeRef &baseFile);
+    bool fileBufferRangeLoaded(const FileNodeRef &baseFile, qint64 offset, qint64 length);
+    const QByteArray getFileBufferRange(const FileNodeRef &baseFile, qint64 offset, qint64 length);
     void setFileBuffer(const FileNodeRef &theFile, const QByteArray * toSet);
     FileNodeRef getParent(const FileNodeRef &theFile);
     QList<FileNodeRef> getChildList(const FileNodeRef &theFile);
@@ -144,6 +150,7 @@ private:
     FileTreeNode * getFileNodeFromNodeRef(const FileNodeRef &thedata, bool verifyTimestamp = true);
 
     void emitStdFileOpErr(QString errString, RequestState errState);
+    void setReplyPriority(RemoteDataReply * theReply, RequestPriority basePriority);
 
     RemoteDataInterface * myInterface = nullptr;
     FileRecursiveOperator * myRecursiveHandler = nullptr;
@@ -167,9 +167,28 @@ void FileRecursiveOperator::abortRecursiveProcess()
     }
 
     myState = RecursiveOpState::IDLE;
+
+    //With the state idle, the cancelled replies are ignored as they come back
+    QList<QPointer<RemoteDataReply>> toCancel = activeReplies;
+    activeReplies.clear();
+    for (QPointer<RemoteDataReply> aReply : toCancel)
+    {
+        if (!aReply.isNull()) aReply->cancel();
+    }
+
     fileOpDone(RequestState::STOPPED_BY_USER, toDisplay);
 }
 
+void FileRecursiveOperator::trackReply(RemoteDataReply * theReply, RequestPriority priorityClass)
+{
+    if (theReply == nullptr) return;
+
+    //Requests made for this operation share one client queue, so they take turns with others
+    theReply->setRequestPriority(priorityClass, this);
+    activeReplies.removeAll(QPointer<RemoteDataReply>());
+    activeReplies.append(theReply);
+}
+
 void FileRecursiveOperator::newFileSystemDataInterlock(FileNodeRef)
 {
     if (interlockHasFileChange) return;
@@ -269,7 +288,7 @@ bool FileRecursiveOperator::recursiveDownloadRetrivalHelper(const FileNodeRef &n
     {
         if (nodeToCheck.getFileBuffer() == nullptr)
         {
-            myOperator->sendDownloadBuffReq(nodeToCheck);
+            trackReply(myOperator->sendDownloadBuffReq(nodeToCheck), RequestPriority::BULK);
             return false;
         }
         return true;
@@ -361,7 +380,7 @@ void FileRecursiveOperator::recursiveUploadProcessRetry()
     FileNodeRef trueRemoteHead = recursiveRemoteHead.getChildWithName(recursiveLocalHead.dirName());
     if (trueRemoteHead.isNil())
     {
-        myOperator->sendCreateFolderReq(recursiveRemoteHead, recursiveLocalHead.dirName());
+        trackReply(myOperator->sendCreateFolderReq(recursiveRemoteHead, recursiveLocalHead.dirName()), RequestPriority::INTERACTIVE);
         return;
     }
 
@@ -419,7 +438,7 @@ bool FileRecursiveOperator::recursiveUploadHelper(const FileNodeRef &nodeToSend,
             FileNodeRef childNode = nodeToSend.getChildWithName(childDir.dirName());
             if (childNode.isNil())
             {
-                myOperator->sendCreateFolderReq(nodeToSend, childDir.dirName());
+                trackReply(myOperator->sendCreateFolderReq(nodeToSend, childDir.dirName()), RequestPriority::INTERACTIVE);
                 return false;
             }
             if (!recursiveUploadHelper(childNode, childDir, errNum)) return false;
@@ -429,7 +448,7 @@ bool FileRecursiveOperator::recursiveUploadHelper(const FileNodeRef &nodeToSend,
             FileNodeRef childNode = nodeToSend.getChildWithName(anEntry.fileName());
             if (childNode.isNil())
             {
-                myOperator->sendUploadReq(nodeToSend, anEntry.absoluteFilePath());
+                trackReply(myOperator->sendUploadReq(nodeToSend, anEntry.absoluteFilePath()), RequestPriority::BULK);
                 return false;
             }
             if (nodeToSend.getFileType() != FileType::FILE)
@@ -38,12 +38,14 @@
 
 #include <QObject>
 #include <QDir>
+#include <QPointer>
 
 #include "filemetadata.h"
 #include "filenoderef.h"
 
 class FileOperator;
 class FileNodeRef;
+class RemoteDataReply;
 
 enum class RequestState;
 enum class RecursiveErrorCodes {NONE, MKDIR_FAIL, UPLOAD_FAIL, TYPE_MISSMATCH, LOST_FILE};
@@ -75,6 +77,7 @@ private slots:
 protected:
     void getRecursiveUploadReply(RequestState replyState, FileMetaData newFileData);
     void getRecursiveMkdirReply(RequestState replyState, FileMetaData newFolderData);
+    void trackReply(RemoteDataReply * theReply, RequestPriority priorityClass);
 
 private:
     void recursiveDownloadProcessRetry();
@@ -94,6 +97,9 @@ private:
 
     QDir recursiveLocalHead;
     FileNodeRef recursiveRemoteHead;
+
+    //Transfers sent for the current operation, so that an abort can stop them
+    QList<QPointer<RemoteDataReply>> activeReplies;
 };
 
 #endif // FILERECURSIVEOPERATOR_H
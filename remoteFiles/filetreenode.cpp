@@ -150,6 +150,7 @@ void FileTreeNode::deleteFolderContentsData()
 void FileTreeNode::setFileBuffer(const QByteArray * newFileBuffer)
 {
     if (fileDataBuffer != nullptr) delete fileDataBuffer;
+    loadedRanges.clear();
 
     if (newFileBuffer == nullptr)
     {
@@ -164,6 +165,30 @@ void FileTreeNode::setFileBuffer(const QByteArray * newFileBuffer)
     recomputeNodeState();
 }
 
+bool FileTreeNode::bufferRangeLoaded(qint64 offset, qint64 length)
+{
+    length = clipToFileSize(offset, length);
+    if (fileDataBuffer != nullptr) return (offset + length <= fileDataBuffer->size());
+    if (length <= 0) return false;
+
+    auto itr = loadedRanges.upperBound(offset);
+    if (itr == loadedRanges.begin()) return false;
+    itr--;
+    return (itr.key() + itr.value().size() >= offset + length);
+}
+
+QByteArray FileTreeNode::getBufferRange(qint64 offset, qint64 length)
+{
+    if (!bufferRangeLoaded(offset, length)) return QByteArray();
+    length = clipToFileSize(offset, length);
+
+    if (fileDataBuffer != nullptr) return fileDataBuffer->mid(static_cast<int>(offset), static_cast<int>(length));
+
+    auto itr = loadedRanges.upperBound(offset);
+    itr--;
+    return itr.value().mid(static_cast<int>(offset - itr.key()), static_cast<int>(length));
+}
+
 bool FileTreeNode::haveLStask()
 {
     return (lsTask != nullptr);
@@ -207,6 +232,8 @@ void FileTreeNode::setBuffTask(RemoteDataReply * newTask)
     bufferTask = newTask;
     QObject::connect(bufferTask, SIGNAL(haveBufferDownloadReply(RequestState,QByteArray)),
                      this, SLOT(deliverBuffData(RequestState,QByteArray)));
+    QObject::connect(bufferTask, SIGNAL(haveBufferRangeReply(RequestState,qint64,QByteArray)),
+                     this, SLOT(deliverBuffRangeData(RequestState,qint64,QByteArray)));
     recomputeNodeState();
 }
 
@@ -309,6 +336,82 @@ void FileTreeNode::deliverBuffData(RequestState taskState, QByteArray bufferData
     recomputeNodeState();
 }
 
+void FileTreeNode::deliverBuffRangeData(RequestState taskState, qint64 offset, QByteArray bufferData)
+{
+    bufferTask = nullptr;
+    if (taskState == RequestState::GOOD)
+    {
+        qCDebug(fileManager, "Download of buffer range complete: %s (%lld, %d)", qPrintable(fileData.getFullPath()), offset, bufferData.size());
+        insertBufferRange(offset, bufferData);
+        setNodeVisible();
+        recomputeNodeState();
+        myFileOperator->fileNodesChange(fileData);
+        return;
+    }
+
+    if (taskState == RequestState::FILE_NOT_FOUND)
+    {
+        changeNodeState(NodeState::DELETING);
+        return;
+    }
+    else
+    {
+        qCDebug(fileManager, "Unable to connect to DesignSafe file server for buffer task.");
+    }
+    recomputeNodeState();
+}
+
+void FileTreeNode::insertBufferRange(qint64 offset, QByteArray newData)
+{
+    if (fileDataBuffer != nullptr) return;
+    if (newData.isEmpty()) return;
+
+    qint64 mergedStart = offset;
+    qint64 mergedEnd = offset + newData.size();
+
+    //Any piece that overlaps or touches the new one is folded into it
+    QList<qint64> toMerge;
+    for (auto itr = loadedRanges.cbegin(); itr != loadedRanges.cend(); itr++)
+    {
+        qint64 rangeEnd = itr.key() + itr.value().size();
+        if ((itr.key() > mergedEnd) || (rangeEnd < offset)) continue;
+        toMerge.append(itr.key());
+        mergedStart = qMin(mergedStart, itr.key());
+        mergedEnd = qMax(mergedEnd, rangeEnd);
+    }
+
+    QByteArray mergedData;
+    if (toMerge.isEmpty())
+    {
+        mergedData = newData;
+    }
+    else
+    {
+        mergedData.resize(static_cast<int>(mergedEnd - mergedStart));
+        for (qint64 aKey : toMerge)
+        {
+            QByteArray oldData = loadedRanges.take(aKey);
+            memcpy(mergedData.data() + (aKey - mergedStart), oldData.constData(), oldData.size());
+        }
+        memcpy(mergedData.data() + (offset - mergedStart), newData.constData(), newData.size());
+    }
+
+    //Once the pieces cover the whole file, it is held as an ordinary file buffer
+    if ((mergedStart == 0) && (fileData.getSize() > 0) && (mergedData.size() >= fileData.getSize()))
+    {
+        setFileBuffer(&mergedData);
+        return;
+    }
+
+    loadedRanges.insert(mergedStart, mergedData);
+}
+
+qint64 FileTreeNode::clipToFileSize(qint64 offset, qint64 length)
+{
+    if (fileData.getSize() <= 0) return length;
+    return qMax(Q_INT64_C(0), qMin(length, fileData.getSize() - offset));
+}
+
 void FileTreeNode::setNodeVisible()
 {
     if (nodeVisible) return;
@@ -41,6 +41,7 @@
 #include <QObject>
 #include <QStandardItem>
 #include <QDateTime>
+#include <QMap>
 #include <QPersistentModelIndex>
 
 class FileStandardItem;
@@ -91,12 +92,15 @@ public:
 
     void deleteFolderContentsData();
     void setFileBuffer(const QByteArray *newFileBuffer);
+    bool bufferRangeLoaded(qint64 offset, qint64 length);
+    QByteArray getBufferRange(qint64 offset, qint64 length);
 
     QPersistentModelIndex getFirstModelIndex();
 
 private slots:
     void deliverLSdata(RequestState taskState, QList<FileMetaData> dataList);
     void deliverBuffData(RequestState taskState, QByteArray bufferData);
+    void deliverBuffRangeData(RequestState taskState, qint64 offset, QByteArray bufferData);
 
 private:
     void setNodeVisible();
@@ -120,6 +124,9 @@ private:
     void insertFile(FileMetaData *newData);
     void purgeUnmatchedChildren(QList<FileMetaData> * newChildList);
 
+    void insertBufferRange(qint64 offset, QByteArray newData);
+    qint64 clipToFileSize(qint64 offset, qint64 length);
+
     FileOperator * myFileOperator = nullptr;
     FileTreeNode * myParent = nullptr;
 
@@ -127,6 +134,8 @@ private:
     QList<FileTreeNode *> childList;
 
     QByteArray * fileDataBuffer = nullptr;
+    //Pieces of the file loaded by ranged requests, by offset. Adjacent pieces are merged.
+    QMap<qint64, QByteArray> loadedRanges;
 
     RemoteDataReply * lsTask = nullptr;
     RemoteDataReply * bufferTask = nullptr;
@@ -0,0 +1,346 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "remotefiledevice.h"
+
+#include "remotedatainterface.h"
+
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+
+RemoteFileDevice::RemoteFileDevice(RemoteDataInterface * theInterface, QString remoteName, qint64 remoteSize, QObject * parent) :
+    QIODevice(parent)
+{
+    myInterface = theInterface;
+    remoteFileName = remoteName;
+    remoteFileSize = remoteSize;
+}
+
+RemoteFileDevice::~RemoteFileDevice()
+{
+    close();
+}
+
+bool RemoteFileDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || (myInterface == nullptr) || (remoteFileSize < 0))
+    {
+        setErrorString("RemoteFileDevice is read only and needs an interface and file size");
+        return false;
+    }
+
+    //Blocks are the only buffering; QIODevice's own would read past what was asked for
+    if (!QIODevice::open(mode | QIODevice::Unbuffered)) return false;
+
+    wantBlock(0);
+    return true;
+}
+
+void RemoteFileDevice::close()
+{
+    for (auto itr = activeFetches.cbegin(); itr != activeFetches.cend(); itr++)
+    {
+        QObject::disconnect(itr.key(), nullptr, this, nullptr);
+        itr.key()->cancel();
+    }
+    activeFetches.clear();
+    queuedFetches.clear();
+    clearCache();
+    lastReadBlock = -1;
+
+    QIODevice::close();
+}
+
+bool RemoteFileDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 RemoteFileDevice::size() const
+{
+    return remoteFileSize;
+}
+
+bool RemoteFileDevice::seek(qint64 pos)
+{
+    if (!QIODevice::seek(pos)) return false;
+    if (pos < remoteFileSize) wantBlock(blockForPos(pos));
+    return true;
+}
+
+bool RemoteFileDevice::atEnd() const
+{
+    return (pos() >= remoteFileSize);
+}
+
+qint64 RemoteFileDevice::bytesAvailable() const
+{
+    //Only bytes already cached can be read without waiting
+    qint64 ret = 0;
+    qint64 checkPos = pos();
+    while (checkPos < remoteFileSize)
+    {
+        qint64 blockNum = blockForPos(checkPos);
+        if (!blockCache.contains(blockNum)) break;
+        qint64 blockEnd = (blockNum * blockSize) + blockCache.value(blockNum).size();
+        ret += blockEnd - checkPos;
+        checkPos = blockEnd;
+    }
+    return ret + QIODevice::bytesAvailable();
+}
+
+bool RemoteFileDevice::waitForReadyRead(int msecs)
+{
+    if (!isOpen() || atEnd()) return false;
+
+    qint64 blockNum = blockForPos(pos());
+    if (blockCache.contains(blockNum)) return true;
+    if (failedBlocks.contains(blockNum)) return false;
+    wantBlock(blockNum);
+
+    QEventLoop waitLoop;
+    QObject::connect(this, SIGNAL(readyRead()), &waitLoop, SLOT(quit()));
+    if (msecs >= 0)
+    {
+        QTimer::singleShot(msecs, &waitLoop, SLOT(quit()));
+    }
+
+    //readyRead comes for every block that lands, so keep waiting until it is this one
+    QElapsedTimer waitTime;
+    waitTime.start();
+    while (!blockCache.contains(blockNum) && !failedBlocks.contains(blockNum))
+    {
+        if ((msecs >= 0) && (waitTime.elapsed() >= msecs)) break;
+        waitLoop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+
+    return blockCache.contains(blockNum);
+}
+
+void RemoteFileDevice::setBlockSize(qint64 newSize)
+{
+    if ((newSize <= 0) || (newSize == blockSize)) return;
+
+    //Cached blocks are keyed by block number, so they do not survive a size change
+    for (auto itr = activeFetches.cbegin(); itr != activeFetches.cend(); itr++)
+    {
+        QObject::disconnect(itr.key(), nullptr, this, nullptr);
+        itr.key()->cancel();
+    }
+    activeFetches.clear();
+    queuedFetches.clear();
+    clearCache();
+
+    blockSize = newSize;
+}
+
+void RemoteFileDevice::setCacheBlockCount(int newCount)
+{
+    if (newCount < 1) return;
+    cacheBlockCount = newCount;
+
+    while (lruOrder.size() > cacheBlockCount)
+    {
+        blockCache.remove(lruOrder.takeFirst());
+    }
+}
+
+void RemoteFileDevice::setReadAheadBlocks(int newCount)
+{
+    if (newCount < 0) return;
+    readAheadBlocks = newCount;
+}
+
+void RemoteFileDevice::setMaxConcurrentFetches(int newCount)
+{
+    if (newCount < 1) return;
+    maxConcurrentFetches = newCount;
+    startQueuedFetches();
+}
+
+qint64 RemoteFileDevice::readData(char * data, qint64 maxSize)
+{
+    qint64 readPos = pos();
+    if (readPos >= remoteFileSize) return -1;
+
+    qint64 totalRead = 0;
+    while ((totalRead < maxSize) && (readPos < remoteFileSize))
+    {
+        qint64 blockNum = blockForPos(readPos);
+
+        if (failedBlocks.contains(blockNum))
+        {
+            //Clear the failure, so a later read tries again
+            failedBlocks.remove(blockNum);
+            if (totalRead == 0) return -1;
+            break;
+        }
+
+        if (!blockCache.contains(blockNum))
+        {
+            wantBlock(blockNum);
+            break;
+        }
+
+        if (blockNum == lastReadBlock + 1)
+        {
+            readAheadFrom(blockNum + 1);
+        }
+        lastReadBlock = blockNum;
+        touchBlock(blockNum);
+
+        const QByteArray &theBlock = blockCache[blockNum];
+        qint64 inBlock = readPos - (blockNum * blockSize);
+        qint64 toCopy = qMin(maxSize - totalRead, theBlock.size() - inBlock);
+        if (toCopy <= 0) break;
+
+        memcpy(data + totalRead, theBlock.constData() + inBlock, static_cast<size_t>(toCopy));
+        totalRead += toCopy;
+        readPos += toCopy;
+    }
+
+    return totalRead;
+}
+
+qint64 RemoteFileDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+void RemoteFileDevice::blockArrived(RequestState replyState, qint64 offset, QByteArray blockData)
+{
+    RemoteDataReply * theReply = qobject_cast<RemoteDataReply *>(sender());
+    if (!activeFetches.contains(theReply)) return;
+
+    qint64 blockNum = activeFetches.take(theReply);
+
+    if (replyState != RequestState::GOOD)
+    {
+        qCDebug(remoteInterface, "ERROR: Unable to fetch block %lld of %s: %s", blockNum, qPrintable(remoteFileName),
+                qPrintable(RemoteDataInterface::interpretRequestState(replyState)));
+        setErrorString(RemoteDataInterface::interpretRequestState(replyState));
+        failedBlocks.insert(blockNum);
+    }
+    else if ((offset != blockNum * blockSize) || (blockData.size() > blockSize))
+    {
+        qCDebug(remoteInterface, "ERROR: Block %lld of %s does not match the range asked for", blockNum, qPrintable(remoteFileName));
+        setErrorString(RemoteDataInterface::interpretRequestState(RequestState::MISSING_REPLY_DATA));
+        failedBlocks.insert(blockNum);
+    }
+    else
+    {
+        storeBlock(blockNum, blockData);
+    }
+
+    startQueuedFetches();
+    emit readyRead();
+}
+
+qint64 RemoteFileDevice::blockForPos(qint64 pos) const
+{
+    return pos / blockSize;
+}
+
+void RemoteFileDevice::wantBlock(qint64 blockNum)
+{
+    if ((blockNum < 0) || (blockNum * blockSize >= remoteFileSize)) return;
+    if (blockCache.contains(blockNum)) return;
+    if (queuedFetches.contains(blockNum)) return;
+    for (auto itr = activeFetches.cbegin(); itr != activeFetches.cend(); itr++)
+    {
+        if (itr.value() == blockNum) return;
+    }
+
+    failedBlocks.remove(blockNum);
+    queuedFetches.append(blockNum);
+    startQueuedFetches();
+}
+
+void RemoteFileDevice::readAheadFrom(qint64 blockNum)
+{
+    for (int i = 0; i < readAheadBlocks; i++)
+    {
+        wantBlock(blockNum + i);
+    }
+}
+
+void RemoteFileDevice::startQueuedFetches()
+{
+    while ((activeFetches.size() < maxConcurrentFetches) && !queuedFetches.isEmpty())
+    {
+        qint64 blockNum = queuedFetches.takeFirst();
+        qint64 blockStart = blockNum * blockSize;
+        qint64 blockLength = qMin(blockSize, remoteFileSize - blockStart);
+
+        RemoteDataReply * newReply = myInterface->downloadBufferRange(remoteFileName, blockStart, blockLength);
+        if (newReply == nullptr)
+        {
+            failedBlocks.insert(blockNum);
+            continue;
+        }
+
+        newReply->setRequestPriority(RequestPriority::BACKGROUND, this);
+        activeFetches.insert(newReply, blockNum);
+        QObject::connect(newReply, SIGNAL(haveBufferRangeReply(RequestState,qint64,QByteArray)),
+                         this, SLOT(blockArrived(RequestState,qint64,QByteArray)));
+    }
+}
+
+void RemoteFileDevice::storeBlock(qint64 blockNum, QByteArray blockData)
+{
+    if (!blockCache.contains(blockNum))
+    {
+        while (lruOrder.size() >= cacheBlockCount)
+        {
+            blockCache.remove(lruOrder.takeFirst());
+        }
+    }
+    blockCache.insert(blockNum, blockData);
+    touchBlock(blockNum);
+}
+
+void RemoteFileDevice::touchBlock(qint64 blockNum)
+{
+    lruOrder.removeOne(blockNum);
+    lruOrder.append(blockNum);
+}
+
+void RemoteFileDevice::clearCache()
+{
+    blockCache.clear();
+    lruOrder.clear();
+    failedBlocks.clear();
+}
@@ -0,0 +1,120 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef REMOTEFILEDEVICE_H
+#define REMOTEFILEDEVICE_H
+
+#include <QIODevice>
+#include <QHash>
+#include <QSet>
+#include <QList>
+
+class RemoteDataInterface;
+class RemoteDataReply;
+
+enum class RequestState;
+
+/*! \brief The RemoteFileDevice is a read-only, random access QIODevice over one remote file.
+ *
+ *  Reads and seeks are served from fixed-size, aligned blocks, each fetched with its own ranged
+ *  request. Recently used blocks are kept in a small LRU cache, and when reads move forward
+ *  block after block the following blocks are fetched ahead of time. Missing blocks are fetched
+ *  concurrently, up to a limit.
+ *
+ *  Like a socket, the device never blocks: a read at a position whose block has not arrived yet
+ *  returns 0 bytes and starts the fetch, and readyRead is emitted when it lands.
+ *  waitForReadyRead can be used to wait for it, from a thread with an event loop.
+ *
+ *  The remote file size must be given up front, as known from its FileMetaData.
+ */
+
+class RemoteFileDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit RemoteFileDevice(RemoteDataInterface * theInterface, QString remoteName, qint64 remoteSize, QObject * parent = nullptr);
+    ~RemoteFileDevice();
+
+    bool open(OpenMode mode);
+    void close();
+
+    bool isSequential() const;
+    qint64 size() const;
+    bool seek(qint64 pos);
+    bool atEnd() const;
+    qint64 bytesAvailable() const;
+    bool waitForReadyRead(int msecs);
+
+    void setBlockSize(qint64 newSize);
+    void setCacheBlockCount(int newCount);
+    void setReadAheadBlocks(int newCount);
+    void setMaxConcurrentFetches(int newCount);
+
+protected:
+    qint64 readData(char * data, qint64 maxSize);
+    qint64 writeData(const char * data, qint64 maxSize);
+
+private slots:
+    void blockArrived(RequestState replyState, qint64 offset, QByteArray blockData);
+
+private:
+    qint64 blockForPos(qint64 pos) const;
+    void wantBlock(qint64 blockNum);
+    void readAheadFrom(qint64 blockNum);
+    void startQueuedFetches();
+    void storeBlock(qint64 blockNum, QByteArray blockData);
+    void touchBlock(qint64 blockNum);
+    void clearCache();
+
+    RemoteDataInterface * myInterface;
+    QString remoteFileName;
+    qint64 remoteFileSize;
+
+    qint64 blockSize = 262144;
+    int cacheBlockCount = 64;
+    int readAheadBlocks = 4;
+    int maxConcurrentFetches = 4;
+
+    QHash<qint64, QByteArray> blockCache;
+    QList<qint64> lruOrder; //Least recently used first
+    QHash<RemoteDataReply *, qint64> activeFetches;
+    QList<qint64> queuedFetches;
+    QSet<qint64> failedBlocks;
+
+    qint64 lastReadBlock = -1;
+};
+
+#endif // REMOTEFILEDEVICE_H
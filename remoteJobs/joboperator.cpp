@@ -90,9 +90,9 @@ void JobOperator::refreshRunningJobList(RequestState replyState, QList<RemoteJob
     currentJobRefreshReply = nullptr;
     if (replyState != RequestState::GOOD)
     {
+        //Transient failures were already retried by the interface
         qCDebug(jobManager, "Error: unable to list jobs. Bad reply from agave connection.");
         //TODO: Add more error passing
-        QTimer::singleShot(5000, this, SLOT(demandJobDataRefresh()));
         return;
     }
 
@@ -134,6 +134,7 @@ void JobOperator::refreshRunningJobList(RequestState replyState, QList<RemoteJob
 
     emit newJobData();
 
+    //Unfinished jobs are polled until they reach a terminal state
     if (notDone)
     {
         QTimer::singleShot(5000, this, SLOT(demandJobDataRefresh()));
@@ -193,6 +194,7 @@ void JobOperator::requestJobDetails(const RemoteJobData *toFetch)
     RemoteDataReply * jobReply = myInterface->getJobDetails(realNode->getData().getID());
 
     if (jobReply == nullptr) return; //TODO: Consider an error message here
+    jobReply->setRequestPriority(RequestPriority::INTERACTIVE, this);
 
     realNode->setDetailTask(jobReply);
 }
@@ -204,6 +206,7 @@ void JobOperator::deleteJobDataEntry(const RemoteJobData *toDelete)
     if (realNode == nullptr) return;
 
     RemoteDataReply * jobReply = myInterface->deleteJob(realNode->getData().getID());
+    jobReply->setRequestPriority(RequestPriority::INTERACTIVE, this);
     QObject::connect(jobReply, SIGNAL(haveDeletedJob(RequestState)), this, SLOT(jobOperationFollowup(RequestState)));
     emit jobOpStarted();
 }
@@ -244,6 +247,7 @@ void JobOperator::demandJobDataRefresh()
         return;
     }
     currentJobRefreshReply = myInterface->getListOfJobs();
+    currentJobRefreshReply->setRequestPriority(RequestPriority::BACKGROUND, this);
     QObject::connect(currentJobRefreshReply, SIGNAL(haveJobList(RequestState,QList<RemoteJobData>)),
                      this, SLOT(refreshRunningJobList(RequestState,QList<RemoteJobData>)));
 }
@@ -0,0 +1,226 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "remotedatafuture.h"
+
+RemoteReplyWatcher::RemoteReplyWatcher(RemoteDataReply * theReply) : QObject(nullptr)
+{
+    this->moveToThread(theReply->thread());
+    QObject::connect(theReply, SIGNAL(destroyed()), this, SLOT(deleteLater()));
+}
+
+void RemoteReplyWatcher::haveListReply(RequestState replyState, QList<FileMetaData> fileDataList)
+{
+    listPromise->finish(LSResult(replyState, fileDataList));
+}
+
+void RemoteReplyWatcher::haveFileReply(RequestState replyState, FileMetaData fileData)
+{
+    filePromise->finish(FileResult(replyState, fileData));
+}
+
+void RemoteReplyWatcher::haveChangedFileReply(RequestState replyState, FileMetaData fileData, QString)
+{
+    filePromise->finish(FileResult(replyState, fileData));
+}
+
+void RemoteReplyWatcher::havePathReply(RequestState replyState, QString filePath)
+{
+    pathPromise->finish(PathResult(replyState, filePath));
+}
+
+void RemoteReplyWatcher::haveBufferReply(RequestState replyState, QByteArray fileBuffer)
+{
+    bufferPromise->finish(BufferResult(replyState, fileBuffer));
+}
+
+void RemoteReplyWatcher::haveBufferRangeReply(RequestState replyState, qint64 offset, QByteArray fileBuffer)
+{
+    bufferRangePromise->finish(BufferRangeResult(replyState, qMakePair(offset, fileBuffer)));
+}
+
+void RemoteReplyWatcher::haveJobStartReply(RequestState replyState, QJsonDocument rawJobReply)
+{
+    jobStartPromise->finish(JobStartResult(replyState, rawJobReply));
+}
+
+void RemoteReplyWatcher::haveJobListReply(RequestState replyState, QList<RemoteJobData> jobList)
+{
+    jobListPromise->finish(JobListResult(replyState, jobList));
+}
+
+void RemoteReplyWatcher::haveJobDetailsReply(RequestState replyState, RemoteJobData jobData)
+{
+    jobPromise->finish(JobResult(replyState, jobData));
+}
+
+void RemoteReplyWatcher::haveStateReply(RequestState replyState)
+{
+    statePromise->finish(StateResult(replyState, NoRemoteValue()));
+}
+
+RemoteReplyWatcher * RemoteDataFuture::watchReply(RemoteDataReply * theReply)
+{
+    if (theReply == nullptr)
+    {
+        qCDebug(remoteInterface, "ERROR: Future requested for null reply.");
+        return nullptr;
+    }
+    return new RemoteReplyWatcher(theReply);
+}
+
+QFuture<LSResult> RemoteDataFuture::listing(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<LSResult>> promise(new RemotePromise<LSResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->listPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveLSReply(RequestState,QList<FileMetaData>)),
+                     watcher, SLOT(haveListReply(RequestState,QList<FileMetaData>)));
+    return promise->future();
+}
+
+QFuture<FileResult> RemoteDataFuture::fileData(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<FileResult>> promise(new RemotePromise<FileResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->filePromise = promise;
+    QObject::connect(theReply, SIGNAL(haveMoveReply(RequestState,FileMetaData,QString)),
+                     watcher, SLOT(haveChangedFileReply(RequestState,FileMetaData,QString)));
+    QObject::connect(theReply, SIGNAL(haveCopyReply(RequestState,FileMetaData)),
+                     watcher, SLOT(haveFileReply(RequestState,FileMetaData)));
+    QObject::connect(theReply, SIGNAL(haveRenameReply(RequestState,FileMetaData,QString)),
+                     watcher, SLOT(haveChangedFileReply(RequestState,FileMetaData,QString)));
+    QObject::connect(theReply, SIGNAL(haveMkdirReply(RequestState,FileMetaData)),
+                     watcher, SLOT(haveFileReply(RequestState,FileMetaData)));
+    QObject::connect(theReply, SIGNAL(haveUploadReply(RequestState,FileMetaData)),
+                     watcher, SLOT(haveFileReply(RequestState,FileMetaData)));
+    return promise->future();
+}
+
+QFuture<PathResult> RemoteDataFuture::filePath(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<PathResult>> promise(new RemotePromise<PathResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->pathPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveDeleteReply(RequestState,QString)),
+                     watcher, SLOT(havePathReply(RequestState,QString)));
+    QObject::connect(theReply, SIGNAL(haveDownloadReply(RequestState,QString)),
+                     watcher, SLOT(havePathReply(RequestState,QString)));
+    return promise->future();
+}
+
+QFuture<BufferResult> RemoteDataFuture::buffer(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<BufferResult>> promise(new RemotePromise<BufferResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->bufferPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveBufferDownloadReply(RequestState,QByteArray)),
+                     watcher, SLOT(haveBufferReply(RequestState,QByteArray)));
+    return promise->future();
+}
+
+QFuture<BufferRangeResult> RemoteDataFuture::bufferRange(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<BufferRangeResult>> promise(new RemotePromise<BufferRangeResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->bufferRangePromise = promise;
+    QObject::connect(theReply, SIGNAL(haveBufferRangeReply(RequestState,qint64,QByteArray)),
+                     watcher, SLOT(haveBufferRangeReply(RequestState,qint64,QByteArray)));
+    return promise->future();
+}
+
+QFuture<JobStartResult> RemoteDataFuture::jobStart(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<JobStartResult>> promise(new RemotePromise<JobStartResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->jobStartPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveJobReply(RequestState,QJsonDocument)),
+                     watcher, SLOT(haveJobStartReply(RequestState,QJsonDocument)));
+    return promise->future();
+}
+
+QFuture<JobListResult> RemoteDataFuture::jobList(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<JobListResult>> promise(new RemotePromise<JobListResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->jobListPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveJobList(RequestState,QList<RemoteJobData>)),
+                     watcher, SLOT(haveJobListReply(RequestState,QList<RemoteJobData>)));
+    return promise->future();
+}
+
+QFuture<JobResult> RemoteDataFuture::jobDetails(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<JobResult>> promise(new RemotePromise<JobResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->jobPromise = promise;
+    QObject::connect(theReply, SIGNAL(haveJobDetails(RequestState,RemoteJobData)),
+                     watcher, SLOT(haveJobDetailsReply(RequestState,RemoteJobData)));
+    return promise->future();
+}
+
+QFuture<StateResult> RemoteDataFuture::state(RemoteDataReply * theReply)
+{
+    QSharedPointer<RemotePromise<StateResult>> promise(new RemotePromise<StateResult>());
+    RemoteReplyWatcher * watcher = watchReply(theReply);
+    if (watcher == nullptr) return promise->future();
+
+    watcher->statePromise = promise;
+    QObject::connect(theReply, SIGNAL(haveAuthReply(RequestState)),
+                     watcher, SLOT(haveStateReply(RequestState)));
+    QObject::connect(theReply, SIGNAL(startedLogout(RequestState)),
+                     watcher, SLOT(haveStateReply(RequestState)));
+    QObject::connect(theReply, SIGNAL(haveStoppedJob(RequestState)),
+                     watcher, SLOT(haveStateReply(RequestState)));
+    QObject::connect(theReply, SIGNAL(haveDeletedJob(RequestState)),
+                     watcher, SLOT(haveStateReply(RequestState)));
+    return promise->future();
+}
@@ -0,0 +1,309 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#ifndef REMOTEDATAFUTURE_H
+#define REMOTEDATAFUTURE_H
+
+#include "remotedatainterface.h"
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QPair>
+
+#include <functional>
+#include <utility>
+
+/*! \brief A RemoteResult is the outcome of one remote request, as given by the futures of RemoteDataFuture.
+ *
+ *  The value is only meaningful if replyState is GOOD.
+ */
+
+template <typename ValueType>
+class RemoteResult
+{
+public:
+    RemoteResult() {}
+    RemoteResult(RequestState newState, ValueType newValue) : replyState(newState), value(newValue) {}
+
+    bool isGood() const {return (replyState == RequestState::GOOD);}
+
+    RequestState replyState = RequestState::INTERNAL_ERROR;
+    ValueType value = ValueType();
+};
+
+//For replies which give nothing but their state
+class NoRemoteValue {};
+
+typedef RemoteResult<QList<FileMetaData>> LSResult;
+typedef RemoteResult<FileMetaData> FileResult;
+typedef RemoteResult<QString> PathResult;
+typedef RemoteResult<QByteArray> BufferResult;
+typedef RemoteResult<QPair<qint64, QByteArray>> BufferRangeResult;
+typedef RemoteResult<QJsonDocument> JobStartResult;
+typedef RemoteResult<QList<RemoteJobData>> JobListResult;
+typedef RemoteResult<RemoteJobData> JobResult;
+typedef RemoteResult<NoRemoteValue> StateResult;
+
+/*! \brief A RemotePromise is the writing end of one QFuture.
+ *
+ *  If it is destroyed before a result is given, the future is finished as canceled, with no result,
+ *  so nothing waits on it forever.
+ */
+
+template <typename ResultType>
+class RemotePromise
+{
+public:
+    RemotePromise() {myInterface.reportStarted();}
+    ~RemotePromise() {drop();}
+
+    QFuture<ResultType> future() {return myInterface.future();}
+
+    void finish(const ResultType &theResult)
+    {
+        if (myInterface.isFinished()) return;
+        myInterface.reportResult(theResult);
+        myInterface.reportFinished();
+    }
+
+    void drop()
+    {
+        if (myInterface.isFinished()) return;
+        myInterface.reportCanceled();
+        myInterface.reportFinished();
+    }
+
+private:
+    QFutureInterface<ResultType> myInterface;
+};
+
+/*! \brief The RemoteReplyWatcher gives the result of one RemoteDataReply to a RemotePromise.
+ *
+ *  It lives in the thread of the reply, so the promise is kept without any event loop in the
+ *  thread of the caller. It is deleted along with the reply.
+ */
+
+class RemoteReplyWatcher : public QObject
+{
+    Q_OBJECT
+
+    friend class RemoteDataFuture;
+
+public:
+    explicit RemoteReplyWatcher(RemoteDataReply * theReply);
+
+private slots:
+    void haveListReply(RequestState replyState, QList<FileMetaData> fileDataList);
+    void haveFileReply(RequestState replyState, FileMetaData fileData);
+    void haveChangedFileReply(RequestState replyState, FileMetaData fileData, QString oldName);
+    void havePathReply(RequestState replyState, QString filePath);
+    void haveBufferReply(RequestState replyState, QByteArray fileBuffer);
+    void haveBufferRangeReply(RequestState replyState, qint64 offset, QByteArray fileBuffer);
+    void haveJobStartReply(RequestState replyState, QJsonDocument rawJobReply);
+    void haveJobListReply(RequestState replyState, QList<RemoteJobData> jobList);
+    void haveJobDetailsReply(RequestState replyState, RemoteJobData jobData);
+    void haveStateReply(RequestState replyState);
+
+private:
+    //Only the one for the kind of future asked for is set:
+    QSharedPointer<RemotePromise<LSResult>> listPromise;
+    QSharedPointer<RemotePromise<FileResult>> filePromise;
+    QSharedPointer<RemotePromise<PathResult>> pathPromise;
+    QSharedPointer<RemotePromise<BufferResult>> bufferPromise;
+    QSharedPointer<RemotePromise<BufferRangeResult>> bufferRangePromise;
+    QSharedPointer<RemotePromise<JobStartResult>> jobStartPromise;
+    QSharedPointer<RemotePromise<JobListResult>> jobListPromise;
+    QSharedPointer<RemotePromise<JobResult>> jobPromise;
+    QSharedPointer<RemotePromise<StateResult>> statePromise;
+};
+
+/*! \brief The RemoteDataFuture gives the result of a RemoteDataReply as a QFuture, in place of its signals.
+ *
+ *  Each of listing, fileData and so on should be called right after the request is made, on the
+ *  reply the request gave, and picks the signal matching that request:
+ *
+ *  listing: remoteLS \n
+ *  fileData: moveFile, copyFile, renameFile, mkRemoteDir, uploadFile, uploadBuffer, uploadStream \n
+ *  filePath: deleteFile, downloadFile, downloadToDevice \n
+ *  buffer: downloadBuffer \n
+ *  bufferRange: downloadBufferRange \n
+ *  jobStart: runRemoteJob \n
+ *  jobList: getListOfJobs \n
+ *  jobDetails: getJobDetails \n
+ *  state: performAuth, closeAllConnections, stopJob, deleteJob
+ *
+ *  The futures can be waited on from any thread. then, whenAll and whenAny chain them, running
+ *  each step in the thread of a given context object, which needs an event loop. A step may
+ *  return a value or another QFuture, to be waited on in turn. A future finished without a
+ *  result (see RemotePromise) skips any steps after it, and makes whenAll finish the same way.
+ */
+
+class RemoteDataFuture
+{
+public:
+    static QFuture<LSResult> listing(RemoteDataReply * theReply);
+    static QFuture<FileResult> fileData(RemoteDataReply * theReply);
+    static QFuture<PathResult> filePath(RemoteDataReply * theReply);
+    static QFuture<BufferResult> buffer(RemoteDataReply * theReply);
+    static QFuture<BufferRangeResult> bufferRange(RemoteDataReply * theReply);
+    static QFuture<JobStartResult> jobStart(RemoteDataReply * theReply);
+    static QFuture<JobListResult> jobList(RemoteDataReply * theReply);
+    static QFuture<JobResult> jobDetails(RemoteDataReply * theReply);
+    static QFuture<StateResult> state(RemoteDataReply * theReply);
+
+    template <typename ValueType>
+    struct FutureValue {typedef ValueType type;};
+    template <typename ValueType>
+    struct FutureValue<QFuture<ValueType>> {typedef ValueType type;};
+
+    template <typename SourceType, typename StepFunction>
+    static auto then(QFuture<SourceType> source, QObject * context, StepFunction nextStep)
+        -> QFuture<typename FutureValue<decltype(nextStep(std::declval<SourceType>()))>::type>
+    {
+        typedef typename FutureValue<decltype(nextStep(std::declval<SourceType>()))>::type ResultType;
+        QSharedPointer<RemotePromise<ResultType>> promise(new RemotePromise<ResultType>());
+
+        whenFinished(source, context, [promise, source, context, nextStep]()
+        {
+            if (source.resultCount() < 1)
+            {
+                promise->drop();
+                return;
+            }
+            deliver(promise, nextStep(source.result()), context);
+        });
+        return promise->future();
+    }
+
+    //Gives every result, in the order of sources
+    template <typename ValueType>
+    static QFuture<QList<ValueType>> whenAll(QList<QFuture<ValueType>> sources, QObject * context)
+    {
+        QSharedPointer<RemotePromise<QList<ValueType>>> promise(new RemotePromise<QList<ValueType>>());
+        if (sources.isEmpty())
+        {
+            promise->finish(QList<ValueType>());
+            return promise->future();
+        }
+
+        QSharedPointer<QList<QFuture<ValueType>>> sourceList(new QList<QFuture<ValueType>>(sources));
+        QSharedPointer<int> remaining(new int(sources.size()));
+        for (const QFuture<ValueType> &aSource : sources)
+        {
+            //All run in the thread of context, one at a time
+            whenFinished(aSource, context, [promise, sourceList, remaining]()
+            {
+                (*remaining)--;
+                if (*remaining > 0) return;
+
+                QList<ValueType> resultList;
+                resultList.reserve(sourceList->size());
+                for (const QFuture<ValueType> &finishedSource : *sourceList)
+                {
+                    if (finishedSource.resultCount() < 1)
+                    {
+                        promise->drop();
+                        return;
+                    }
+                    resultList.append(finishedSource.result());
+                }
+                promise->finish(resultList);
+            });
+        }
+        return promise->future();
+    }
+
+    //Gives the first result to arrive, with its index in sources
+    template <typename ValueType>
+    static QFuture<QPair<int, ValueType>> whenAny(QList<QFuture<ValueType>> sources, QObject * context)
+    {
+        QSharedPointer<RemotePromise<QPair<int, ValueType>>> promise(new RemotePromise<QPair<int, ValueType>>());
+        for (int i = 0; i < sources.size(); i++)
+        {
+            QFuture<ValueType> aSource = sources.at(i);
+            whenFinished(aSource, context, [promise, aSource, i]()
+            {
+                if (aSource.resultCount() < 1) return;
+                promise->finish(qMakePair(i, aSource.result()));
+            });
+        }
+        //With no sources, or none giving a result, the promise is dropped once nothing holds it
+        return promise->future();
+    }
+
+private:
+    static RemoteReplyWatcher * watchReply(RemoteDataReply * theReply);
+
+    template <typename ValueType>
+    static void whenFinished(QFuture<ValueType> source, QObject * context, std::function<void()> onFinished)
+    {
+        //The watcher must belong to the thread of context, so it is made there
+        QTimer::singleShot(0, context, [source, context, onFinished]()
+        {
+            QFutureWatcher<ValueType> * watcher = new QFutureWatcher<ValueType>(context);
+            QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, onFinished]()
+            {
+                watcher->deleteLater();
+                onFinished();
+            });
+            watcher->setFuture(source);
+        });
+    }
+
+    template <typename ValueType>
+    static void deliver(QSharedPointer<RemotePromise<ValueType>> promise, ValueType theResult, QObject *)
+    {
+        promise->finish(theResult);
+    }
+
+    template <typename ValueType>
+    static void deliver(QSharedPointer<RemotePromise<ValueType>> promise, QFuture<ValueType> innerFuture, QObject * context)
+    {
+        whenFinished(innerFuture, context, [promise, innerFuture]()
+        {
+            if (innerFuture.resultCount() < 1)
+            {
+                promise->drop();
+                return;
+            }
+            promise->finish(innerFuture.result());
+        });
+    }
+};
+
+#endif // REMOTEDATAFUTURE_H
@@ -94,6 +94,8 @@ QString RemoteDataInterface::interpretRequestState(RequestState theState)
         return "An unclassified error occured";
     case RequestState::STOPPED_BY_USER:
         return "Task stopped by user";
+    case RequestState::TIMED_OUT:
+        return "Remote request took too long and was stopped";
     }
     return "INTERNAL ERROR";
 }
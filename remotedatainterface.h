@@ -77,9 +77,26 @@ enum class RequestState {GOOD, PENDING,
                          EXPLICIT_ERROR, MISSING_REPLY_STATUS,
                          MISSING_REPLY_DATA, STOPPED_BY_USER,
                          INVALID_PARAM, NOT_READY,
-                         NOT_IMPLEMENTED, UNCLASSIFIED};
+                         NOT_IMPLEMENTED, TIMED_OUT, UNCLASSIFIED};
+Q_DECLARE_METATYPE(RequestState)
+Q_DECLARE_METATYPE(FileMetaData)
+Q_DECLARE_METATYPE(RemoteJobData)
 //If RemoteDataReply returned is nullptr, then the request was invalid due to internal error
 
+//Requests are sent in order of priority class, each class having its own limit on requests in flight
+enum class RequestPriority {INTERACTIVE, BACKGROUND, BULK};
+Q_DECLARE_METATYPE(RequestPriority)
+
+/*! \brief A RemoteDataReply gives the result of one request made through a RemoteDataInterface, by one of its signals.
+ *
+ *  A reply never gives its result from within the call that made the request, even for a request
+ *  that fails at once. The result is given from the event loop of the interface's thread, so a
+ *  caller in that thread need only connect to the reply before returning to the event loop.
+ *  A caller in another thread gets a reply that holds its signals until the caller has connected
+ *  to a result signal, so no signal is lost in between. haveDownloadChunk should be connected
+ *  before the result signal. If the result is not wanted, setAsUnconnectedReply should be called
+ *  instead, or the held result is kept until the interface is destroyed.
+ */
 class RemoteDataReply : public QObject
 {
     Q_OBJECT
@@ -87,6 +104,11 @@ class RemoteDataReply : public QObject
 public:
     RemoteDataReply(QObject * parent);
     virtual void setAsUnconnectedReply() = 0;
+    //Should be called right after the request is made, client is used to share bandwidth fairly between callers
+    virtual void setRequestPriority(RequestPriority newPriority, QObject * client = nullptr) = 0;
+    //Stops the request, including any network transfer, and gives its reply with STOPPED_BY_USER
+    //From the interface's thread the reply is given at once; from any other it follows from the event loop
+    virtual void cancel() = 0;
 
 signals:
     //All referenced values should be copied by the reciever or they will be discarded
@@ -105,6 +127,10 @@ signals:
     void haveUploadReply(RequestState replyState, FileMetaData newFileData);
     void haveDownloadReply(RequestState replyState, QString localDest);
     void haveBufferDownloadReply(RequestState replyState, QByteArray fileBuffer);
+    //offset is where fileBuffer starts in the remote file; a server without range support gives NOT_IMPLEMENTED
+    void haveBufferRangeReply(RequestState replyState, qint64 offset, QByteArray fileBuffer);
+    //Given by downloadToDevice for each piece of the file as it arrives, before the final haveDownloadReply
+    void haveDownloadChunk(qint64 offset, QByteArray chunk);
 
     //Job replys should be in an intelligble format, JSON is used by Agave and AWS for various things
     void haveJobReply(RequestState replyState, QJsonDocument rawJobReply);
@@ -159,8 +185,14 @@ public slots:
 
     virtual RemoteDataReply * uploadFile(QString location, QString localFileName) = 0;
     virtual RemoteDataReply * uploadBuffer(QString location, QByteArray fileData, QString newFileName) = 0;
+    //Uploads exactly expectedSize bytes read from dataSource as they become available
+    //dataSource must be open, belong to the interface's thread and stay valid until the reply is given
+    virtual RemoteDataReply * uploadStream(QString location, QIODevice * dataSource, QString newFileName, qint64 expectedSize) = 0;
     virtual RemoteDataReply * downloadFile(QString localDest, QString remoteName) = 0;
     virtual RemoteDataReply * downloadBuffer(QString remoteName) = 0;
+    virtual RemoteDataReply * downloadBufferRange(QString remoteName, qint64 offset, qint64 length) = 0;
+    //Writes the file into sink as it arrives, if sink is not null; sink must belong to the interface's thread
+    virtual RemoteDataReply * downloadToDevice(QString remoteName, QIODevice * sink) = 0;
 
     virtual RemoteDataReply * runRemoteJob(QString jobName, ParamMap jobParameters, QString remoteWorkingDir, QString indivJobName = "", QString archivePath = "") = 0;
 
@@ -0,0 +1,6 @@
+TARGET = tst_agavedownloadtarget
+
+include(../../tests.pri)
+
+SOURCES += \
+    tst_agavedownloadtarget.cpp
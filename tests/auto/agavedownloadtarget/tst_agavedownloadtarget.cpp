@@ -0,0 +1,188 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveInterfaces/agavedownloadtarget.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+class tst_AgaveDownloadTarget : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void journalRoundTrip();
+    void resumeMustMatchJournal();
+    void resumeCompletesFile();
+    void commitMovesFileIntoPlace();
+    void discardRemovesPartAndJournal();
+    void positionedWritesAreNotJournaled();
+
+private:
+    //Leaves a suspended partial download of suspendAt bytes of fileData, as an interrupted transfer would
+    void leavePartialDownload(qint64 suspendAt, QByteArray lastModified);
+
+    QScopedPointer<QTemporaryDir> tempDir;
+    QString destName;
+    QByteArray fileData;
+
+    const QString remoteName = "user/data/results.bin";
+    const QByteArray remoteStamp = "Wed, 21 Oct 2015 07:28:00 GMT";
+};
+
+void tst_AgaveDownloadTarget::init()
+{
+    tempDir.reset(new QTemporaryDir());
+    QVERIFY(tempDir->isValid());
+    destName = tempDir->filePath("results.bin");
+
+    fileData.clear();
+    for (int i = 0; i < 1000; i++)
+    {
+        fileData.append(static_cast<char>(i % 251));
+    }
+}
+
+void tst_AgaveDownloadTarget::leavePartialDownload(qint64 suspendAt, QByteArray lastModified)
+{
+    AgaveDownloadTarget theTarget(destName);
+    QVERIFY(theTarget.open(0));
+    theTarget.setRemoteInfo(remoteName, fileData.size(), lastModified);
+    QVERIFY(theTarget.append(fileData.left(static_cast<int>(suspendAt))));
+    theTarget.suspend();
+}
+
+void tst_AgaveDownloadTarget::journalRoundTrip()
+{
+    leavePartialDownload(300, remoteStamp);
+    QVERIFY(QFile::exists(destName + ".part"));
+    QVERIFY(!QFile::exists(destName));
+
+    QByteArray lastModified;
+    qint64 remoteSize = -1;
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, &lastModified, &remoteSize), qint64(300));
+    QCOMPARE(lastModified, remoteStamp);
+    QCOMPARE(remoteSize, qint64(fileData.size()));
+}
+
+void tst_AgaveDownloadTarget::resumeMustMatchJournal()
+{
+    //A partial file without a validator cannot be safely resumed
+    leavePartialDownload(300, QByteArray());
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr), qint64(0));
+
+    leavePartialDownload(300, remoteStamp);
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, "user/data/other.bin", nullptr), qint64(0));
+
+    //A partial file shorter than its journal has lost data
+    QFile partFile(destName + ".part");
+    QVERIFY(partFile.resize(100));
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr), qint64(0));
+
+    //Nor is anything resumed over a finished file
+    leavePartialDownload(300, remoteStamp);
+    QFile finishedFile(destName);
+    QVERIFY(finishedFile.open(QIODevice::WriteOnly));
+    finishedFile.close();
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr), qint64(0));
+}
+
+void tst_AgaveDownloadTarget::resumeCompletesFile()
+{
+    leavePartialDownload(300, remoteStamp);
+    qint64 resumeOffset = AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr);
+    QCOMPARE(resumeOffset, qint64(300));
+
+    AgaveDownloadTarget theTarget(destName);
+    QVERIFY(theTarget.open(resumeOffset));
+    QCOMPARE(theTarget.getBytesWritten(), resumeOffset);
+    QVERIFY(theTarget.append(fileData.mid(static_cast<int>(resumeOffset))));
+    QVERIFY(theTarget.commit());
+
+    QFile finishedFile(destName);
+    QVERIFY(finishedFile.open(QIODevice::ReadOnly));
+    QCOMPARE(finishedFile.readAll(), fileData);
+    QVERIFY(!QFile::exists(destName + ".part"));
+    QVERIFY(!QFile::exists(destName + ".part.journal"));
+}
+
+void tst_AgaveDownloadTarget::commitMovesFileIntoPlace()
+{
+    AgaveDownloadTarget theTarget(destName);
+    QVERIFY(theTarget.open(0));
+    //Space reserved past what the server finally sent is trimmed off
+    theTarget.preallocate(fileData.size() + 500);
+    QVERIFY(theTarget.append(fileData));
+    QVERIFY(theTarget.commit());
+
+    QFile finishedFile(destName);
+    QVERIFY(finishedFile.open(QIODevice::ReadOnly));
+    QCOMPARE(finishedFile.readAll(), fileData);
+
+    //An existing destination is never overwritten
+    AgaveDownloadTarget secondTarget(destName);
+    QVERIFY(!secondTarget.open(0));
+}
+
+void tst_AgaveDownloadTarget::discardRemovesPartAndJournal()
+{
+    AgaveDownloadTarget theTarget(destName);
+    QVERIFY(theTarget.open(0));
+    theTarget.setRemoteInfo(remoteName, fileData.size(), remoteStamp);
+    QVERIFY(theTarget.append(fileData.left(300)));
+    theTarget.discard();
+
+    QVERIFY(!QFile::exists(destName + ".part"));
+    QVERIFY(!QFile::exists(destName + ".part.journal"));
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr), qint64(0));
+}
+
+void tst_AgaveDownloadTarget::positionedWritesAreNotJournaled()
+{
+    AgaveDownloadTarget theTarget(destName);
+    QVERIFY(theTarget.open(0));
+    theTarget.setRemoteInfo(remoteName, fileData.size(), remoteStamp);
+    QVERIFY(theTarget.writeAt(500, fileData.mid(500, 100)));
+    theTarget.suspend();
+
+    //The file may have gaps, so it is dropped rather than kept for resume
+    QVERIFY(!QFile::exists(destName + ".part"));
+    QCOMPARE(AgaveDownloadTarget::findResumeOffset(destName, remoteName, nullptr), qint64(0));
+}
+
+QTEST_APPLESS_MAIN(tst_AgaveDownloadTarget)
+#include "tst_agavedownloadtarget.moc"
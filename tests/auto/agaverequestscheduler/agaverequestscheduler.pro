@@ -0,0 +1,6 @@
+TARGET = tst_agaverequestscheduler
+
+include(../../tests.pri)
+
+SOURCES += \
+    tst_agaverequestscheduler.cpp
@@ -0,0 +1,221 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveInterfaces/agaverequestscheduler.h"
+#include "agaveInterfaces/agavehandler.h"
+
+#include <QtTest>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+//A reply that stays in flight until the test finishes it
+class HeldReply : public QNetworkReply
+{
+public:
+    explicit HeldReply(QObject * parent) : QNetworkReply(parent)
+    {
+        open(QIODevice::ReadOnly);
+    }
+
+    void finishNow()
+    {
+        setFinished(true);
+        emit finished();
+    }
+
+    virtual void abort() {}
+
+protected:
+    virtual qint64 readData(char *, qint64) { return -1; }
+};
+
+class tst_AgaveRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void higherClassesGoFirst();
+    void eachClassHasItsOwnLimit();
+    void clientsAreServedRoundRobin();
+    void goneOwnerIsSkipped();
+    void unsentRequestTakesNoSlot();
+
+private:
+    void enqueue(RequestPriority priorityClass, QObject * client, QString requestName, QObject * owner = nullptr);
+    void finish(QString requestName);
+
+    QNetworkAccessManager * theManager = nullptr;
+    AgaveHandler * theHandler = nullptr;
+    AgaveRequestScheduler * theScheduler = nullptr;
+
+    QStringList sentRequests;
+    QMap<QString, HeldReply *> heldReplies;
+};
+
+void tst_AgaveRequestScheduler::init()
+{
+    theManager = new QNetworkAccessManager();
+    theHandler = new AgaveHandler(theManager);
+    theScheduler = new AgaveRequestScheduler(theHandler);
+    sentRequests.clear();
+    heldReplies.clear();
+}
+
+void tst_AgaveRequestScheduler::cleanup()
+{
+    delete theHandler;
+    delete theManager;
+}
+
+void tst_AgaveRequestScheduler::enqueue(RequestPriority priorityClass, QObject * client, QString requestName, QObject * owner)
+{
+    if (owner == nullptr) owner = this;
+    theScheduler->enqueueRawRequest(priorityClass, client, owner, [=]() -> QNetworkReply *
+    {
+        sentRequests.append(requestName);
+        HeldReply * newReply = new HeldReply(theHandler);
+        heldReplies.insert(requestName, newReply);
+        return newReply;
+    });
+}
+
+void tst_AgaveRequestScheduler::finish(QString requestName)
+{
+    QVERIFY(heldReplies.contains(requestName));
+    heldReplies.value(requestName)->finishNow();
+    QCoreApplication::processEvents();
+}
+
+void tst_AgaveRequestScheduler::higherClassesGoFirst()
+{
+    theScheduler->setMaxInFlight(RequestPriority::INTERACTIVE, 1);
+    theScheduler->setMaxInFlight(RequestPriority::BACKGROUND, 1);
+    theScheduler->setMaxInFlight(RequestPriority::BULK, 1);
+
+    enqueue(RequestPriority::BULK, this, "bulk");
+    enqueue(RequestPriority::BACKGROUND, this, "background");
+    enqueue(RequestPriority::INTERACTIVE, this, "interactive1");
+    enqueue(RequestPriority::INTERACTIVE, this, "interactive2");
+    QCoreApplication::processEvents();
+
+    //Classes are served in order, each up to its own limit
+    QCOMPARE(sentRequests, QStringList({"interactive1", "background", "bulk"}));
+    QCOMPARE(theScheduler->queuedRequestCount(), 1);
+
+    finish("interactive1");
+    QCOMPARE(sentRequests.last(), QString("interactive2"));
+    QCOMPARE(theScheduler->queuedRequestCount(), 0);
+}
+
+void tst_AgaveRequestScheduler::eachClassHasItsOwnLimit()
+{
+    theScheduler->setMaxInFlight(RequestPriority::BULK, 2);
+    QCOMPARE(theScheduler->getMaxInFlight(RequestPriority::BULK), 2);
+
+    for (int i = 0; i < 5; i++)
+    {
+        enqueue(RequestPriority::BULK, this, QString("bulk%1").arg(i));
+    }
+    enqueue(RequestPriority::INTERACTIVE, this, "interactive");
+    QCoreApplication::processEvents();
+
+    //A full bulk class does not hold up the interactive one
+    QCOMPARE(sentRequests, QStringList({"interactive", "bulk0", "bulk1"}));
+
+    finish("bulk0");
+    QCOMPARE(sentRequests.size(), 4);
+    QCOMPARE(sentRequests.last(), QString("bulk2"));
+
+    finish("interactive");
+    QCOMPARE(sentRequests.size(), 4);
+}
+
+void tst_AgaveRequestScheduler::clientsAreServedRoundRobin()
+{
+    theScheduler->setMaxInFlight(RequestPriority::BULK, 1);
+    QObject clientA;
+    QObject clientB;
+
+    enqueue(RequestPriority::BULK, &clientA, "a1");
+    enqueue(RequestPriority::BULK, &clientA, "a2");
+    enqueue(RequestPriority::BULK, &clientA, "a3");
+    enqueue(RequestPriority::BULK, &clientB, "b1");
+    enqueue(RequestPriority::BULK, &clientB, "b2");
+    QCoreApplication::processEvents();
+
+    while (sentRequests.size() < 5)
+    {
+        int sentBefore = sentRequests.size();
+        finish(sentRequests.last());
+        QCOMPARE(sentRequests.size(), sentBefore + 1);
+    }
+    QCOMPARE(sentRequests, QStringList({"a1", "b1", "a2", "b2", "a3"}));
+}
+
+void tst_AgaveRequestScheduler::goneOwnerIsSkipped()
+{
+    theScheduler->setMaxInFlight(RequestPriority::BULK, 1);
+    QObject * shortOwner = new QObject();
+
+    enqueue(RequestPriority::BULK, this, "blocker");
+    enqueue(RequestPriority::BULK, this, "orphan", shortOwner);
+    enqueue(RequestPriority::BULK, this, "kept");
+    QCoreApplication::processEvents();
+    delete shortOwner;
+
+    finish("blocker");
+    QCOMPARE(sentRequests, QStringList({"blocker", "kept"}));
+}
+
+void tst_AgaveRequestScheduler::unsentRequestTakesNoSlot()
+{
+    theScheduler->setMaxInFlight(RequestPriority::BULK, 1);
+
+    theScheduler->enqueueRawRequest(RequestPriority::BULK, this, this, [=]() -> QNetworkReply *
+    {
+        sentRequests.append("failed");
+        return nullptr;
+    });
+    enqueue(RequestPriority::BULK, this, "next");
+    QCoreApplication::processEvents();
+
+    QCOMPARE(sentRequests, QStringList({"failed", "next"}));
+}
+
+QTEST_GUILESS_MAIN(tst_AgaveRequestScheduler)
+#include "tst_agaverequestscheduler.moc"
@@ -0,0 +1,6 @@
+TARGET = tst_agaveretrypolicy
+
+include(../../tests.pri)
+
+SOURCES += \
+    tst_agaveretrypolicy.cpp
@@ -0,0 +1,190 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveInterfaces/agaveretrypolicy.h"
+
+#include <QtTest>
+#include <QNetworkReply>
+
+//A finished reply with a given status, error and Retry-After header, as the policy sees a failed request
+class FailedReply : public QNetworkReply
+{
+public:
+    FailedReply(int statusCode, QNetworkReply::NetworkError errorCode, QByteArray retryAfter = QByteArray())
+    {
+        if (statusCode > 0)
+        {
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, statusCode);
+        }
+        setError(errorCode, QString());
+        if (!retryAfter.isEmpty())
+        {
+            setRawHeader("Retry-After", retryAfter);
+        }
+        open(QIODevice::ReadOnly);
+        setFinished(true);
+    }
+
+    virtual void abort() {}
+
+protected:
+    virtual qint64 readData(char *, qint64) { return -1; }
+};
+
+class tst_AgaveRetryPolicy : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void retryableFailures_data();
+    void retryableFailures();
+    void backoffDoublesWithinCap();
+    void attemptsAreLimited();
+    void retryAfterOverridesBackoff();
+    void longRetryAfterIsNotRetried();
+    void parseRetryAfter();
+    void budgetLimitsRetries();
+};
+
+void tst_AgaveRetryPolicy::retryableFailures_data()
+{
+    QTest::addColumn<int>("statusCode");
+    QTest::addColumn<int>("errorCode");
+    QTest::addColumn<bool>("retryable");
+
+    QTest::newRow("429") << 429 << static_cast<int>(QNetworkReply::UnknownContentError) << true;
+    QTest::newRow("502") << 502 << static_cast<int>(QNetworkReply::UnknownServerError) << true;
+    QTest::newRow("503") << 503 << static_cast<int>(QNetworkReply::ServiceUnavailableError) << true;
+    QTest::newRow("504") << 504 << static_cast<int>(QNetworkReply::UnknownServerError) << true;
+    QTest::newRow("404") << 404 << static_cast<int>(QNetworkReply::ContentNotFoundError) << false;
+    QTest::newRow("500") << 500 << static_cast<int>(QNetworkReply::InternalServerError) << false;
+    QTest::newRow("401") << 401 << static_cast<int>(QNetworkReply::AuthenticationRequiredError) << false;
+    QTest::newRow("connection dropped") << 0 << static_cast<int>(QNetworkReply::RemoteHostClosedError) << true;
+    QTest::newRow("timeout") << 0 << static_cast<int>(QNetworkReply::TimeoutError) << true;
+    QTest::newRow("connection refused") << 0 << static_cast<int>(QNetworkReply::ConnectionRefusedError) << false;
+    QTest::newRow("ssl failure") << 0 << static_cast<int>(QNetworkReply::SslHandshakeFailedError) << false;
+}
+
+void tst_AgaveRetryPolicy::retryableFailures()
+{
+    QFETCH(int, statusCode);
+    QFETCH(int, errorCode);
+    QFETCH(bool, retryable);
+
+    AgaveRetryPolicy thePolicy;
+    FailedReply theReply(statusCode, static_cast<QNetworkReply::NetworkError>(errorCode));
+    QCOMPARE(thePolicy.isRetryableFailure(&theReply), retryable);
+    QCOMPARE(thePolicy.takeRetryDelay(&theReply, 0) >= 0, retryable);
+}
+
+void tst_AgaveRetryPolicy::backoffDoublesWithinCap()
+{
+    AgaveRetryPolicy thePolicy;
+    thePolicy.setMaxAttempts(100);
+    thePolicy.setRetryBudget(1000, 60000);
+    thePolicy.setBackoff(100, 1000);
+
+    //Up to half of each wait is taken off at random, so each attempt falls in [ceiling / 2, ceiling]
+    const QList<qint64> ceilings = {100, 200, 400, 800, 1000, 1000};
+    for (int attempt = 0; attempt < ceilings.size(); attempt++)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            qint64 delay = thePolicy.takeRetryDelay(attempt);
+            QVERIFY2((delay >= ceilings.at(attempt) / 2) && (delay <= ceilings.at(attempt)),
+                     qPrintable(QString("attempt %1 gave %2").arg(attempt).arg(delay)));
+        }
+    }
+}
+
+void tst_AgaveRetryPolicy::attemptsAreLimited()
+{
+    AgaveRetryPolicy thePolicy;
+    thePolicy.setMaxAttempts(3);
+    FailedReply theReply(503, QNetworkReply::ServiceUnavailableError);
+
+    QVERIFY(thePolicy.takeRetryDelay(&theReply, 2) >= 0);
+    QCOMPARE(thePolicy.takeRetryDelay(&theReply, 3), qint64(-1));
+    QCOMPARE(thePolicy.takeRetryDelay(3), qint64(-1));
+}
+
+void tst_AgaveRetryPolicy::retryAfterOverridesBackoff()
+{
+    AgaveRetryPolicy thePolicy;
+    FailedReply theReply(429, QNetworkReply::UnknownContentError, "2");
+    QCOMPARE(thePolicy.takeRetryDelay(&theReply, 0), qint64(2000));
+}
+
+void tst_AgaveRetryPolicy::longRetryAfterIsNotRetried()
+{
+    AgaveRetryPolicy thePolicy;
+    FailedReply theReply(503, QNetworkReply::ServiceUnavailableError, "3600");
+    QCOMPARE(thePolicy.takeRetryDelay(&theReply, 0), qint64(-1));
+}
+
+void tst_AgaveRetryPolicy::parseRetryAfter()
+{
+    QCOMPARE(AgaveRetryPolicy::parseRetryAfter("5"), qint64(5000));
+    QCOMPARE(AgaveRetryPolicy::parseRetryAfter(" 0 "), qint64(0));
+    QCOMPARE(AgaveRetryPolicy::parseRetryAfter("-1"), qint64(-1));
+    QCOMPARE(AgaveRetryPolicy::parseRetryAfter("soon"), qint64(-1));
+
+    QCOMPARE(AgaveRetryPolicy::parseRetryAfter("Wed, 21 Oct 2015 07:28:00 GMT"), qint64(0));
+
+    QByteArray inThirty = QLocale::c().toString(QDateTime::currentDateTimeUtc().addSecs(30), "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+    qint64 waitTime = AgaveRetryPolicy::parseRetryAfter(inThirty);
+    QVERIFY2((waitTime > 28000) && (waitTime <= 30000), qPrintable(QString::number(waitTime)));
+}
+
+void tst_AgaveRetryPolicy::budgetLimitsRetries()
+{
+    AgaveRetryPolicy thePolicy;
+    thePolicy.setRetryBudget(2, 60000);
+    FailedReply backoffReply(503, QNetworkReply::ServiceUnavailableError);
+    FailedReply retryAfterReply(429, QNetworkReply::UnknownContentError, "1");
+
+    //Waits given by Retry-After draw on the budget too
+    QVERIFY(thePolicy.takeRetryDelay(&backoffReply, 0) >= 0);
+    QVERIFY(thePolicy.takeRetryDelay(&retryAfterReply, 0) >= 0);
+    QCOMPARE(thePolicy.takeRetryDelay(&backoffReply, 0), qint64(-1));
+    QCOMPARE(thePolicy.takeRetryDelay(0), qint64(-1));
+
+    AgaveRetryPolicy noBudget;
+    noBudget.setRetryBudget(0, 60000);
+    QCOMPARE(noBudget.takeRetryDelay(&backoffReply, 0), qint64(-1));
+}
+
+QTEST_APPLESS_MAIN(tst_AgaveRetryPolicy)
+#include "tst_agaveretrypolicy.moc"
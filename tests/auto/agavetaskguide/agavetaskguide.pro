@@ -0,0 +1,6 @@
+TARGET = tst_agavetaskguide
+
+include(../../tests.pri)
+
+SOURCES += \
+    tst_agavetaskguide.cpp
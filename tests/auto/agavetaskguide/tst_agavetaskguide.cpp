@@ -0,0 +1,154 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveInterfaces/agavetaskguide.h"
+#include "agaveInterfaces/agavehandler.h"
+
+#include <QtTest>
+
+class tst_AgaveTaskGuide : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void urlParamsAreFilled_data();
+    void urlParamsAreFilled();
+    void postParamsAreFilled_data();
+    void postParamsAreFilled();
+    void missingVarGivesNoValue();
+    void moreThanNineVars();
+    void fixedValueIsFormEncoded();
+};
+
+void tst_AgaveTaskGuide::urlParamsAreFilled_data()
+{
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("plain") << "%1" << QByteArray("home/user/file.txt") << QByteArray("/files/home/user/file.txt");
+    QTest::newRow("path delimiters kept") << "%1" << QByteArray("a:b@c!$&'()*+,;=") << QByteArray("/files/a:b@c!$&'()*+,;=");
+    QTest::newRow("space and query") << "%1" << QByteArray("my dir/a?b#c") << QByteArray("/files/my%20dir/a%3Fb%23c");
+    QTest::newRow("percent") << "%1" << QByteArray("100%") << QByteArray("/files/100%25");
+    QTest::newRow("utf8") << "%1" << QString::fromUtf8("caf\xc3\xa9").toUtf8() << QByteArray("/files/caf%C3%A9");
+    QTest::newRow("fixed text around") << "x/%1/y" << QByteArray("a b") << QByteArray("/files/x/a%20b/y");
+    QTest::newRow("literal percent not a marker") << "%1/%z" << QByteArray("a") << QByteArray("/files/a/%z");
+}
+
+void tst_AgaveTaskGuide::urlParamsAreFilled()
+{
+    QFETCH(QString, format);
+    QFETCH(QByteArray, value);
+    QFETCH(QByteArray, expected);
+
+    AgaveTaskGuide theGuide("test", AgaveRequestType::AGAVE_GET, AgaveTaskKind::DIR_LISTING);
+    theGuide.setURLsuffix("/files/");
+    theGuide.setDynamicURLParams(format, {"name"});
+    theGuide.compileFormats();
+
+    QMap<QString, QByteArray> varList;
+    varList.insert("name", value);
+    QCOMPARE(theGuide.getArgAndURLsuffix(&varList), expected);
+}
+
+void tst_AgaveTaskGuide::postParamsAreFilled_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("plain") << QByteArray("newdir") << QByteArray("action=mkdir&path=newdir");
+    QTest::newRow("form delimiters") << QByteArray("a&b=c+d") << QByteArray("action=mkdir&path=a%26b%3Dc%2Bd");
+    QTest::newRow("slash encoded") << QByteArray("a/b") << QByteArray("action=mkdir&path=a%2Fb");
+    QTest::newRow("unreserved kept") << QByteArray("A-z_0.9~") << QByteArray("action=mkdir&path=A-z_0.9~");
+    QTest::newRow("nul byte") << QByteArray("a\0b", 3) << QByteArray("action=mkdir&path=a%00b");
+}
+
+void tst_AgaveTaskGuide::postParamsAreFilled()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(QByteArray, expected);
+
+    AgaveTaskGuide theGuide("test", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::NEW_FOLDER);
+    theGuide.setPostParams("action=mkdir&path=%1", {"newName"});
+    theGuide.compileFormats();
+
+    QMap<QString, QByteArray> varList;
+    varList.insert("newName", value);
+    QCOMPARE(theGuide.fillPostArgList(&varList), expected);
+}
+
+void tst_AgaveTaskGuide::missingVarGivesNoValue()
+{
+    AgaveTaskGuide theGuide("test", AgaveRequestType::AGAVE_PUT, AgaveTaskKind::NEW_FOLDER);
+    theGuide.setPostParams("action=mkdir&path=%1", {"newName"});
+
+    QMap<QString, QByteArray> varList;
+    QCOMPARE(theGuide.fillPostArgList(&varList), QByteArray());
+    QCOMPARE(theGuide.fillPostArgList(nullptr), QByteArray());
+
+    //Without names, the format is sent as given
+    AgaveTaskGuide fixedGuide("fixed", AgaveRequestType::AGAVE_POST, AgaveTaskKind::STOP_JOB);
+    fixedGuide.setPostParams("action=stop");
+    QCOMPARE(fixedGuide.fillPostArgList(nullptr), QByteArray("action=stop"));
+}
+
+void tst_AgaveTaskGuide::moreThanNineVars()
+{
+    QStringList names;
+    QMap<QString, QByteArray> varList;
+    QString format;
+    QByteArray expected;
+    for (int i = 1; i <= 11; i++)
+    {
+        names.append(QString("v%1").arg(i));
+        varList.insert(QString("v%1").arg(i), QByteArray::number(i * 100));
+        format.append(QString("%%1,").arg(i));
+        expected.append(QByteArray::number(i * 100)).append(",");
+    }
+
+    AgaveTaskGuide theGuide("test", AgaveRequestType::AGAVE_POST, AgaveTaskKind::JOB_START);
+    theGuide.setPostParams(format, names);
+    QCOMPARE(theGuide.fillPostArgList(&varList), expected);
+}
+
+void tst_AgaveTaskGuide::fixedValueIsFormEncoded()
+{
+    QCOMPARE(AgaveTaskGuide::encodeFixedValue("designsafe.storage.default"), QString("designsafe.storage.default"));
+    QCOMPARE(AgaveTaskGuide::encodeFixedValue("my client/1"), QString("my%20client%2F1"));
+    QCOMPARE(AgaveTaskGuide::encodeFixedValue(QString::fromUtf8("\xc3\xa9&=")), QString("%C3%A9%26%3D"));
+}
+
+QTEST_APPLESS_MAIN(tst_AgaveTaskGuide)
+#include "tst_agavetaskguide.moc"
@@ -0,0 +1,6 @@
+TARGET = tst_replylatency
+
+include(../../tests.pri)
+
+SOURCES += \
+    tst_replylatency.cpp
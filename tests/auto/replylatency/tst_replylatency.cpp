@@ -0,0 +1,113 @@
+/*********************************************************************************
+**
+** Copyright (c) 2017 The University of Notre Dame
+** Copyright (c) 2017 The Regents of the University of California
+**
+** Redistribution and use in source and binary forms, with or without modification,
+** are permitted provided that the following conditions are met:
+**
+** 1. Redistributions of source code must retain the above copyright notice, this
+** list of conditions and the following disclaimer.
+**
+** 2. Redistributions in binary form must reproduce the above copyright notice, this
+** list of conditions and the following disclaimer in the documentation and/or other
+** materials provided with the distribution.
+**
+** 3. Neither the name of the copyright holder nor the names of its contributors may
+** be used to endorse or promote products derived from this software without specific
+** prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+** EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+** SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+** TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+** CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+** IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+** SUCH DAMAGE.
+**
+***********************************************************************************/
+
+// Contributors:
+// Written by Peter Sempolinski, for the Natural Hazard Modeling Laboratory, director: Ahsan Kareem, at Notre Dame
+
+#include "agaveInterfaces/agavehandler.h"
+#include "remotedatainterface.h"
+
+#include <QtTest>
+#include <QNetworkAccessManager>
+#include <QThread>
+
+//Times how long a reply that fails at once takes to reach its caller, in the interface's thread and from another.
+//Run on the revisions before and after a change to the reply path to compare them.
+
+class tst_ReplyLatency : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sameThreadImmediateReply();
+    void crossThreadImmediateReply();
+
+private:
+    QNetworkAccessManager * localManager = nullptr;
+    AgaveHandler * localHandler = nullptr;
+
+    QThread * handlerThread = nullptr;
+    QNetworkAccessManager * threadManager = nullptr;
+    AgaveHandler * threadHandler = nullptr;
+};
+
+void tst_ReplyLatency::initTestCase()
+{
+    localManager = new QNetworkAccessManager(this);
+    localHandler = new AgaveHandler(localManager, this);
+
+    handlerThread = new QThread(this);
+    threadManager = new QNetworkAccessManager();
+    threadHandler = new AgaveHandler(threadManager);
+    threadManager->moveToThread(handlerThread);
+    threadHandler->moveToThread(handlerThread);
+    handlerThread->start();
+}
+
+void tst_ReplyLatency::cleanupTestCase()
+{
+    threadHandler->deleteLater();
+    threadManager->deleteLater();
+    handlerThread->quit();
+    handlerThread->wait();
+}
+
+void tst_ReplyLatency::sameThreadImmediateReply()
+{
+    //Never logged in, so the listing is refused without touching the network
+    QBENCHMARK
+    {
+        RemoteDataReply * theReply = localHandler->remoteLS("/");
+        QVERIFY(theReply != nullptr);
+        QSignalSpy replySpy(theReply, SIGNAL(haveLSReply(RequestState,QList<FileMetaData>)));
+        QVERIFY(replySpy.wait(1000));
+        QCOMPARE(replySpy.first().at(0).value<RequestState>(), RequestState::INVALID_STATE);
+    }
+}
+
+void tst_ReplyLatency::crossThreadImmediateReply()
+{
+    QBENCHMARK
+    {
+        RemoteDataReply * theReply = threadHandler->remoteLS("/");
+        QVERIFY(theReply != nullptr);
+        QSignalSpy replySpy(theReply, SIGNAL(haveLSReply(RequestState,QList<FileMetaData>)));
+        QVERIFY(replySpy.wait(1000));
+        QCOMPARE(replySpy.first().at(0).value<RequestState>(), RequestState::INVALID_STATE);
+    }
+}
+
+QTEST_MAIN(tst_ReplyLatency)
+#include "tst_replylatency.moc"
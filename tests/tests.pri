@@ -0,0 +1,7 @@
+#Shared settings for each test under tests/auto, which builds against the library sources directly
+
+QT += core network widgets testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+include($$PWD/../AgaveClientInterface.pri)
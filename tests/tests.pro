@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    auto/replylatency \
+    auto/agavetaskguide \
+    auto/agaveretrypolicy \
+    auto/agavedownloadtarget \
+    auto/agaverequestscheduler